@@ -0,0 +1,58 @@
+//
+// benchmark/assets.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_BENCHMARK_ASSETS_HPP
+#define SWGL_BENCHMARK_ASSETS_HPP
+#pragma once
+
+#include "swgl/image.hpp"
+#include "swgl/model.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Set by the build to the repository's assets directory.
+#ifndef SWGL_ASSETS_DIR
+#  define SWGL_ASSETS_DIR "assets"
+#endif
+
+namespace swgl { namespace bench {
+
+inline std::string asset_path(char const* name) {
+  return std::string(SWGL_ASSETS_DIR) + "/" + name;
+}
+
+inline std::string read_asset(char const* name) {
+  std::ifstream in(asset_path(name), std::ios::binary);
+  if(!in.is_open()) {
+    throw std::runtime_error("can't open asset " + asset_path(name));
+  }
+  std::ostringstream contents;
+  contents << in.rdbuf();
+  return contents.str();
+}
+
+inline model load_model(char const* name) {
+  std::istringstream in(read_asset(name));
+  return model(in);
+}
+
+inline image load_texture(char const* name) {
+  image texture;
+  if(!texture.read_tga_file(asset_path(name).c_str())) {
+    throw std::runtime_error("can't read texture " + asset_path(name));
+  }
+  texture.flip_vertically();
+  return texture;
+}
+
+}} // namespace swgl::bench
+
+#endif // SWGL_BENCHMARK_ASSETS_HPP
@@ -0,0 +1,86 @@
+//
+// benchmark/draw_model.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "assets.hpp"
+
+#include "swgl/camera.hpp"
+#include "swgl/depth_buffer.hpp"
+#include "swgl/shaders/flat.hpp"
+#include "swgl/shaders/gouraud.hpp"
+#include "swgl/shaders/phong.hpp"
+
+#include <benchmark/benchmark.h>
+
+namespace {
+
+constexpr int target_size = 1024;
+
+// The example's starting view of the model, filling most of the target.
+swgl::shaders::basic_lighted_model::draw_info make_draw_info() {
+  float const radius = 1.5f;
+  swgl::shaders::basic_lighted_model::draw_info info;
+  info.eye = swgl::vector3f(0.3f, 0.2f, radius);
+
+  info.projection       = swgl::matrix4f::identity();
+  info.projection[3][2] = -1.f / radius;
+
+  info.view = swgl::lookat(
+      info.eye, swgl::vector3f::zero(), swgl::vector3f(0.f, 1.f, 0.f));
+  info.view.set_column(3, info.view.get_column(3) * radius);
+
+  info.viewport = swgl::viewport_matrix(0, 0, target_size, target_size);
+  info.model    = swgl::matrix4f::identity();
+
+  info.directional_light = swgl::vector3f(0.f, 0.f, 1.f);
+  info.point_light       = swgl::vector3f(0.5f, 0.5f, 1.f);
+  info.ambient_light     = 0.2f;
+  return info;
+}
+
+// A frame of the african head: fast clears of the target and depth, then
+// the draw.
+template <typename Shader>
+void draw_model(benchmark::State& state) {
+  swgl::model const model =
+      swgl::bench::load_model("african_head/african_head.obj");
+  swgl::image const diffuse = swgl::bench::load_texture(
+      "african_head/african_head_diffuse.tga");
+  swgl::image rt(target_size, target_size, swgl::image::RGB);
+  swgl::depth_buffer depth(target_size, target_size);
+  Shader shader;
+  shader.set_model(model);
+  shader.set_render_target(rt);
+  shader.set_depth(depth);
+  shader.set_albedo(diffuse);
+
+  auto const info = make_draw_info();
+  swgl::pipeline_counters stats;
+  for(auto _ : state) {
+    rt.fast_clear(swgl::image::colour_type(0, 0, 0, 255));
+    depth.fast_clear();
+    stats += shader.draw(info);
+    rt.resolve_clear();
+  }
+
+  state.counters["pixels"] = benchmark::Counter(
+      static_cast<double>(stats.pixel_count()), benchmark::Counter::kIsRate);
+  state.counters["triangles"] = benchmark::Counter(
+      static_cast<double>(stats.triangle_count()),
+      benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+BENCHMARK_TEMPLATE(draw_model, swgl::shaders::flat)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(draw_model, swgl::shaders::gouraud)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(draw_model, swgl::shaders::phong)
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,108 @@
+//
+// benchmark/draw_triangle.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/model.hpp"
+#include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
+
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+
+namespace {
+
+constexpr int target_size = 1024;
+
+// Draws the model's positions as they are, in screen space, in one colour.
+// Each draw is nearer than the last so every pixel passes the depth test.
+class solid : public swgl::pipeline<solid> {
+ public:
+  void set_depth_value(float z) {
+    z_ = z;
+  }
+
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector3f position = swgl::vector3f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<solid>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    vertex_out out;
+    out.position   = get_model().position(face, idx);
+    out.position.z = z_;
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    return swgl::colour<float>(1.f, 0.5f, 0.25f, 1.f);
+  }
+
+  float z_ = 0.f;
+};
+
+// A right triangle with legs of size pixels, off the pixel grid so its
+// edges cut through pixels like a transformed triangle's would.
+swgl::model make_triangle(int size) {
+  float const lo = 0.3f;
+  float const hi = lo + size;
+  std::ostringstream obj;
+  obj << "v " << lo << " " << lo << " 0\n"
+      << "v " << hi << " " << lo << " 0\n"
+      << "v " << lo << " " << hi << " 0\n"
+      << "f 1 2 3\n";
+  std::istringstream in(obj.str());
+  return swgl::model(in);
+}
+
+void draw_triangle(benchmark::State& state, int size) {
+  swgl::model const model = make_triangle(size);
+  swgl::image rt(target_size, target_size, swgl::image::RGB);
+  swgl::depth_buffer depth(target_size, target_size);
+  solid pipeline;
+  pipeline.set_model(model);
+  pipeline.set_render_target(rt);
+  pipeline.set_depth(depth);
+  pipeline.set_cull_mode(swgl::cull_mode::none);
+
+  // Depth steps by whole values, which a float holds exactly up to 2^24.
+  constexpr float max_depth = 1 << 20;
+  float z                   = 0.f;
+  swgl::pipeline_counters stats;
+  for(auto _ : state) {
+    if(z == max_depth) {
+      state.PauseTiming();
+      depth.clear();
+      z = 0.f;
+      state.ResumeTiming();
+    }
+    pipeline.set_depth_value(++z);
+    stats += pipeline.draw();
+  }
+
+  state.counters["pixels"] = benchmark::Counter(
+      static_cast<double>(stats.pixel_count()), benchmark::Counter::kIsRate);
+  state.counters["triangles"] = benchmark::Counter(
+      static_cast<double>(stats.triangle_count()),
+      benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+BENCHMARK_CAPTURE(draw_triangle, small, 4);
+BENCHMARK_CAPTURE(draw_triangle, medium, 64);
+BENCHMARK_CAPTURE(draw_triangle, huge, target_size);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,97 @@
+//
+// benchmark/image.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "assets.hpp"
+
+#include "swgl/colour.hpp"
+#include "swgl/image.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+// Samples the diffuse texture on a grid of uvs that covers it.
+void image_sample(benchmark::State& state) {
+  swgl::image const texture = swgl::bench::load_texture(
+      "african_head/african_head_diffuse.tga");
+  constexpr int steps = 256;
+  float const step    = 1.f / steps;
+  for(auto _ : state) {
+    for(int y = 0; y < steps; ++y) {
+      for(int x = 0; x < steps; ++x) {
+        benchmark::DoNotOptimize(texture.sample(x * step, y * step));
+      }
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * steps * steps);
+}
+
+void image_clear(benchmark::State& state) {
+  int const size = static_cast<int>(state.range(0));
+  swgl::image rt(size, size, swgl::image::RGB);
+  swgl::image::colour_type const c(32, 64, 128, 255);
+  for(auto _ : state) {
+    rt.clear(c);
+    benchmark::ClobberMemory();
+  }
+  state.SetBytesProcessed(
+      state.iterations() * std::int64_t(size) * size * rt.bytespp());
+}
+
+// Writes then reads back the diffuse texture, with and without run length
+// encoding.
+void tga_write(benchmark::State& state) {
+  bool const rle      = state.range(0) != 0;
+  swgl::image texture = swgl::bench::load_texture(
+      "african_head/african_head_diffuse.tga");
+  char const* const filename = "swgl_bench_write.tga";
+  for(auto _ : state) {
+    if(!texture.write_tga_file(filename, rle)) {
+      state.SkipWithError("can't write swgl_bench_write.tga");
+      break;
+    }
+  }
+  std::remove(filename);
+  state.SetBytesProcessed(
+      state.iterations() * std::int64_t(texture.width()) * texture.height() *
+      texture.bytespp());
+}
+
+void tga_read(benchmark::State& state) {
+  bool const rle      = state.range(0) != 0;
+  swgl::image texture = swgl::bench::load_texture(
+      "african_head/african_head_diffuse.tga");
+  char const* const filename = "swgl_bench_read.tga";
+  if(!texture.write_tga_file(filename, rle)) {
+    state.SkipWithError("can't write swgl_bench_read.tga");
+    return;
+  }
+
+  swgl::image read;
+  for(auto _ : state) {
+    if(!read.read_tga_file(filename)) {
+      state.SkipWithError("can't read swgl_bench_read.tga");
+      break;
+    }
+  }
+  std::remove(filename);
+  state.SetBytesProcessed(
+      state.iterations() * std::int64_t(texture.width()) * texture.height() *
+      texture.bytespp());
+}
+
+} // namespace
+
+BENCHMARK(image_sample);
+BENCHMARK(image_clear)->Arg(256)->Arg(1024);
+BENCHMARK(tga_write)->ArgName("rle")->Arg(0)->Arg(1);
+BENCHMARK(tga_read)->ArgName("rle")->Arg(0)->Arg(1);
+
+BENCHMARK_MAIN();
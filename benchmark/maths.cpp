@@ -0,0 +1,103 @@
+//
+// benchmark/maths.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/camera.hpp"
+#include "swgl/geometry/matrix.hpp"
+#include "swgl/geometry/vector.hpp"
+
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+constexpr int count = 1024;
+
+std::vector<swgl::vector3f> make_vectors() {
+  std::vector<swgl::vector3f> v;
+  v.reserve(count);
+  for(int i = 0; i < count; ++i) {
+    v.emplace_back(0.5f + i * 0.25f, 1.f - i * 0.125f, 0.75f + i * 0.5f);
+  }
+  return v;
+}
+
+// The transforms a frame chains together, with something in every element.
+swgl::matrix4f make_matrix(float angle) {
+  swgl::vector3f const eye(std::cos(angle), 0.5f, std::sin(angle));
+  swgl::matrix4f m = swgl::viewport_matrix(0, 0, 1024, 1024) *
+                     swgl::lookat(
+                         eye, swgl::vector3f::zero(),
+                         swgl::vector3f(0.f, 1.f, 0.f));
+  m[3][2] = -0.5f;
+  return m;
+}
+
+void matrix4f_multiply(benchmark::State& state) {
+  swgl::matrix4f const a = make_matrix(0.3f);
+  swgl::matrix4f b       = make_matrix(1.1f);
+  for(auto _ : state) {
+    benchmark::DoNotOptimize(b);
+    swgl::matrix4f const c = a * b;
+    benchmark::DoNotOptimize(c);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+void matrix4f_transform(benchmark::State& state) {
+  swgl::matrix4f const m = make_matrix(0.3f);
+  auto const points      = make_vectors();
+  for(auto _ : state) {
+    for(auto const& p : points) {
+      benchmark::DoNotOptimize(m * swgl::vector_widen<4>(p, 1.f));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+void vector3f_dot(benchmark::State& state) {
+  auto const a = make_vectors();
+  auto const b = make_vectors();
+  for(auto _ : state) {
+    for(int i = 0; i < count; ++i) {
+      benchmark::DoNotOptimize(dot(a[i], b[count - 1 - i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+void vector3f_cross(benchmark::State& state) {
+  auto const a = make_vectors();
+  auto const b = make_vectors();
+  for(auto _ : state) {
+    for(int i = 0; i < count; ++i) {
+      benchmark::DoNotOptimize(cross(a[i], b[count - 1 - i]));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+void vector3f_normalize(benchmark::State& state) {
+  auto const a = make_vectors();
+  for(auto _ : state) {
+    for(auto const& v : a) {
+      benchmark::DoNotOptimize(v.normal());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * count);
+}
+
+} // namespace
+
+BENCHMARK(matrix4f_multiply);
+BENCHMARK(matrix4f_transform);
+BENCHMARK(vector3f_dot);
+BENCHMARK(vector3f_cross);
+BENCHMARK(vector3f_normalize);
+
+BENCHMARK_MAIN();
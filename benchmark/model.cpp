@@ -0,0 +1,40 @@
+//
+// benchmark/model.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "assets.hpp"
+
+#include "swgl/model.hpp"
+
+#include <benchmark/benchmark.h>
+#include <sstream>
+#include <string>
+
+namespace {
+
+// Parses the african head from memory, so only the parser is measured.
+void model_parse(benchmark::State& state) {
+  std::string const obj =
+      swgl::bench::read_asset("african_head/african_head.obj");
+  int faces = 0;
+  for(auto _ : state) {
+    std::istringstream in(obj);
+    swgl::model const model(in);
+    faces = model.nfaces();
+    benchmark::DoNotOptimize(faces);
+  }
+  state.SetBytesProcessed(state.iterations() * std::int64_t(obj.size()));
+  state.counters["triangles"] = benchmark::Counter(
+      static_cast<double>(state.iterations()) * faces,
+      benchmark::Counter::kIsRate);
+}
+
+} // namespace
+
+BENCHMARK(model_parse)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -8,12 +8,15 @@
 //
 #include "swgl/camera.hpp"
 #include "swgl/colour.hpp"
+#include "swgl/frame_manager.hpp"
 #include "swgl/image.hpp"
 #include "swgl/model.hpp"
 #include "swgl/pipeline.hpp"
 #include "swgl/shaders/flat.hpp"
 #include "swgl/shaders/gouraud.hpp"
 #include "swgl/shaders/phong.hpp"
+#include "swgl/thread_pool.hpp"
+#include "swgl/trace.hpp"
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -23,7 +26,9 @@
 
 #include <algorithm>
 #include <chrono>
+#include <cstdint>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <string>
 #include <unordered_map>
@@ -36,27 +41,30 @@ const swgl::colour<std::uint8_t> green =
     swgl::colour<std::uint8_t>(0, 255, 0, 255);
 
 static std::vector<float> get_normalised_depth(
-    std::vector<float> const& depth) {
+    swgl::depth_buffer const& depth) {
+  std::vector<float> depth_copy;
+  depth_copy.reserve(static_cast<std::size_t>(depth.width()) * depth.height());
+  for(int y = 0; y < depth.height(); ++y) {
+    for(int x = 0; x < depth.width(); ++x) {
+      depth_copy.push_back(depth.get(x, y));
+    }
+  }
+
   float min = std::numeric_limits<float>::max();
   float max = -std::numeric_limits<float>::max();
-  for(float f : depth) {
+  for(float f : depth_copy) {
     if(f != -std::numeric_limits<float>::max()) {
       min = std::min(f, min);
       max = std::max(f, max);
     }
   }
   float rng = max - min;
-  std::vector<float> depth_copy;
   if(rng > 0.001f) {
-    depth_copy.resize(depth.size());
     float rng_recip = 1.f / rng;
     std::transform(
-        depth.begin(), depth.end(), depth_copy.begin(),
+        depth_copy.begin(), depth_copy.end(), depth_copy.begin(),
         [min, rng_recip](float sample) { return (sample - min) * rng_recip; });
-    return depth_copy;
   }
-
-  depth_copy = depth;
   return depth_copy;
 }
 
@@ -86,10 +94,10 @@ static swgl::image load_texture(std::string filename, char const* suffix) {
 class application {
  public:
   application()
-      : rt_(width_, height_, swgl::image::RGB)
-      , depth_(width_ * height_) {
+      : frames_(width_, height_) {
     init_window_manager();
     init_imgui();
+    frames_.resize(width_, height_);
   }
 
   ~application() {
@@ -114,46 +122,93 @@ class application {
     swgl::shaders::phong p;
 
     shader_names_ = "Flat\0Gouraud\0Phong\0\0";
-    shaders_.push_back(&f);
-    shaders_.push_back(&g);
-    shaders_.push_back(&p);
+    add_shader(f);
+    add_shader(g);
+    add_shader(p);
     options_.shader = 2;
 
-    f.set_depth(depth_);
     f.set_model(model);
-    f.set_render_target(rt_);
+    f.set_thread_pool(&pool_);
+    f.set_hierarchical_depth(true);
     f.set_albedo(diffuse);
 
-    g.set_depth(depth_);
     g.set_model(model);
-    g.set_render_target(rt_);
+    g.set_thread_pool(&pool_);
+    g.set_hierarchical_depth(true);
     g.set_albedo(diffuse);
 
-    p.set_depth(depth_);
     p.set_model(model);
-    p.set_render_target(rt_);
+    p.set_thread_pool(&pool_);
+    p.set_hierarchical_depth(true);
     p.set_albedo(diffuse);
 
-    swgl::shaders::basic_lighted_model::draw_info draw_data;
-
+    // Frame N + 1 renders on the frame manager's worker while frame N is
+    // presented here. Window events and ImGui stay on this thread.
+    submit_frame();
     while(!glfwWindowShouldClose(window_)) {
-      clear_frame();
-      update();
-      fill_draw_data(draw_data);
-      swgl::shaders::basic_lighted_model const* shader =
-          shaders_[options_.shader];
-
-      swgl::pipeline_counters frame_counters;
-      frame_counters += shader->draw(draw_data);
+      submit_frame();
+      swgl::frame_manager::frame const* frame = frames_.acquire();
       update_window_manager();
-      update_imgui(frame_counters);
-      present();
+      update_imgui(frame->counters);
+      present(*frame);
+      frames_.release();
     }
 
+    // The worker may still be drawing with the shaders on this stack.
+    while(frames_.acquire()) {
+      frames_.release();
+    }
+
+#if SWGL_ENABLE_TRACE
+    // The last frames' worth of events, for chrome://tracing or Perfetto.
+    swgl::write_trace_file("swgl_trace.json");
+#endif
     return 0;
   }
 
  private:
+  using draw_info = swgl::shaders::basic_lighted_model::draw_info;
+  using renderer  = std::function<swgl::pipeline_counters(
+      swgl::frame_manager::frame&,
+      draw_info const&,
+      swgl::primitive_topology,
+      swgl::shading_mode)>;
+
+  template <typename Shader>
+  void add_shader(Shader& shader) {
+    renderers_.push_back(
+        [&shader](
+            swgl::frame_manager::frame& frame, draw_info const& info,
+            swgl::primitive_topology topology, swgl::shading_mode shading) {
+          shader.set_render_target(frame.colour);
+          shader.set_depth(frame.depth);
+          shader.set_topology(topology);
+          shader.set_shading_mode(shading);
+          return shader.draw(info);
+        });
+  }
+
+  void submit_frame() {
+    update();
+    frames_.set_clear_colour(
+        swgl::colour_cast<std::uint8_t>(options_.clear_colour));
+    frames_.set_depth_format(
+        static_cast<swgl::depth_format>(options_.depth_format));
+
+    draw_info draw_data;
+    fill_draw_data(draw_data);
+    renderer const& render = renderers_[options_.shader];
+    auto const topology =
+        static_cast<swgl::primitive_topology>(options_.topology);
+    auto const shading = static_cast<swgl::shading_mode>(options_.shading);
+    frames_.submit([&render, draw_data, topology,
+                    shading](swgl::frame_manager::frame& frame) mutable {
+      draw_data.viewport = swgl::viewport_matrix(
+          0, 0, frame.colour.width(), frame.colour.height());
+      return render(frame, draw_data, topology, shading);
+    });
+  }
+
   static void on_window_resized(GLFWwindow* window, int width, int height) {
     reinterpret_cast<application*>(glfwGetWindowUserPointer(window))
         ->handle_window_resized(width, height);
@@ -233,6 +288,13 @@ class application {
       ImGui::Combo(
           "Display Buffer", &options_.visualize_buffer, "Colour\0Depth\0\0");
       ImGui::Combo("Shader", &options_.shader, shader_names_);
+      ImGui::Combo(
+          "Depth Format", &options_.depth_format,
+          "Float32\0Unorm24\0Unorm16\0\0");
+      ImGui::Combo(
+          "Topology", &options_.topology, "Triangles\0Lines\0Points\0\0");
+      ImGui::Combo(
+          "Shading", &options_.shading, "Forward\0Visibility Buffer\0\0");
       ImGui::Checkbox("Rotate", &options_.auto_rotate);
 
       ImGui::Separator();
@@ -256,9 +318,47 @@ class application {
     {
       ImGui::Begin("Draw Stats");
 
-      ImGui::Text("pixels = %d", frame_stats.pixel_count());
-      ImGui::Text("triangles = %d", frame_stats.triangle_count());
-      ImGui::Text("draws = %d", frame_stats.draw_count());
+      // The counts are 64 bit, which ImGui::Text has no portable format for.
+      auto const count_text = [](char const* label, std::int64_t count) {
+        ImGui::Text("%s = %lld", label, static_cast<long long>(count));
+      };
+      count_text("pixels", frame_stats.pixel_count());
+      count_text("triangles", frame_stats.triangle_count());
+      count_text("lines", frame_stats.line_count());
+      count_text("points", frame_stats.point_count());
+      count_text("draws", frame_stats.draw_count());
+      count_text("culled draws", frame_stats.culled_draw_count());
+      count_text("vertex shaders", frame_stats.vertex_shader_count());
+      ImGui::Text(
+          "vertex cache hits = %.1f%%",
+          100.f * frame_stats.vertex_cache_hit_rate());
+      count_text(
+          "frustum culled triangles",
+          frame_stats.frustum_culled_triangle_count());
+      count_text(
+          "facing culled triangles",
+          frame_stats.facing_culled_triangle_count());
+      count_text(
+          "degenerate triangles", frame_stats.degenerate_triangle_count());
+      count_text("missed triangles", frame_stats.missed_triangle_count());
+      count_text("clipped triangles", frame_stats.clipped_triangle_count());
+      count_text("occluded triangles", frame_stats.occluded_triangle_count());
+      count_text("occluded blocks", frame_stats.occluded_block_count());
+      ImGui::Text("overdraw = %.2f", frame_stats.overdraw_ratio());
+      ImGui::Text(
+          "bbox efficiency = %.1f%%", 100.f * frame_stats.bbox_efficiency());
+#if SWGL_ENABLE_PIPELINE_TIMERS
+      static char const* const stage_names[] = {
+          "vertex shading", "setup", "rasterisation", "fragment shading",
+          "output"};
+      for(int stage = 0; stage < swgl::pipeline_stage_count; ++stage) {
+        auto const s = static_cast<swgl::pipeline_stage>(stage);
+        ImGui::Text(
+            "%s = %.3f ms (%.1f Mcycles)", stage_names[stage],
+            frame_stats.stage_nanoseconds(s) / 1e6,
+            frame_stats.stage_cycles(s) / 1e6);
+      }
+#endif
 
       ImGui::Text(
           "Application average %.3f ms/frame (%.1f FPS)",
@@ -271,7 +371,7 @@ class application {
     ImGui::Render();
   }
 
-  void present() const {
+  void present(swgl::frame_manager::frame const& frame) const {
     glRasterPos2d(-1, -1);
 
     // Because our image isn't 4 byte aligned at the start of each row.
@@ -281,22 +381,21 @@ class application {
     switch(options_.visualize_buffer) {
     case 0:
     default:
-      glDrawPixels(width_, height_, GL_RGB, GL_UNSIGNED_BYTE, rt_.data());
+      glDrawPixels(
+          frame.colour.width(), frame.colour.height(), GL_RGB,
+          GL_UNSIGNED_BYTE, frame.colour.data());
       break;
     case 1:
-      std::vector<float> depth_norm = get_normalised_depth(depth_);
-      glDrawPixels(width_, height_, GL_RED, GL_FLOAT, depth_norm.data());
+      std::vector<float> depth_norm = get_normalised_depth(frame.depth);
+      glDrawPixels(
+          frame.colour.width(), frame.colour.height(), GL_RED, GL_FLOAT,
+          depth_norm.data());
       break;
     }
     ImGui_ImplOpenGL2_RenderDrawData(ImGui::GetDrawData());
     glfwSwapBuffers(window_);
   }
 
-  void clear_frame() {
-    rt_.clear(swgl::colour_cast<std::uint8_t>(options_.clear_colour));
-    std::fill(depth_.begin(), depth_.end(), -std::numeric_limits<float>::max());
-  }
-
   void update() {
     if(options_.auto_rotate) {
       auto time        = std::chrono::steady_clock::now().time_since_epoch();
@@ -317,7 +416,6 @@ class application {
     draw_data.projection    = get_projection();
     draw_data.view          = get_view(draw_data.eye);
     draw_data.ambient_light = 0.2f;
-    draw_data.viewport = swgl::viewport_matrix(0, 0, rt_.width(), rt_.height());
     draw_data.directional_light =
         polar_to_3d(light_theta_phi_[0], light_theta_phi_[1], 1.f);
     draw_data.point_light =
@@ -347,8 +445,7 @@ class application {
   void handle_window_resized(int width, int height) {
     width_  = width;
     height_ = height;
-    rt_     = swgl::image(width, height, swgl::image::RGB);
-    depth_.resize(width * height);
+    frames_.resize(width, height);
     glViewport(0, 0, width_, height_);
   }
 
@@ -369,18 +466,21 @@ class application {
   swgl::vector2f light_theta_phi_;
   float light_distance_ = 1.f;
   swgl::vector3f eye_;
-  swgl::image rt_;
+  swgl::frame_manager frames_;
+  swgl::thread_pool pool_;
   swgl::matrix4f camera_ = swgl::matrix4f::identity();
   swgl::matrix4f model_  = swgl::matrix4f::identity();
-  std::vector<float> depth_;
   char const* shader_names_ = nullptr;
-  std::vector<swgl::shaders::basic_lighted_model*> shaders_;
+  std::vector<renderer> renderers_;
   GLFWwindow* window_;
 
   struct options {
     swgl::colour<float> clear_colour{0, 0, 0, 1};
     int visualize_buffer = 0;
     int shader           = 0;
+    int depth_format     = 0;
+    int topology         = 0;
+    int shading          = 0;
     bool auto_rotate     = true;
   } options_;
 };
@@ -10,8 +10,10 @@
 #define SWGL_COLOUR_HPP
 #pragma once
 
-#include <array>
 #include "swgl/geometry/vector.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdint>
 
 namespace swgl {
 
@@ -0,0 +1,118 @@
+//
+// swgl/command_buffer.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_COMMANDBUFFER_HPP
+#define SWGL_COMMANDBUFFER_HPP
+#pragma once
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/model.hpp"
+#include "swgl/pipeline_counters.hpp"
+#include "swgl/shaders/basic_lighted_model.hpp"
+
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace swgl {
+
+// Records draws so they can be built on any number of threads and executed
+// later, in an order chosen for the renderer rather than the caller.
+class command_buffer {
+ public:
+  using draw_info = shaders::basic_lighted_model::draw_info;
+
+  // Records a draw of m with shader into rt and depth, textured with albedo
+  // for shaders that take one. The model, targets and albedo are set on the
+  // shader when the command executes, so one shader can be recorded with
+  // different state, and a null albedo leaves the shader's own. The shader
+  // itself is not touched until then, so this is safe to call from several
+  // threads at once, including while another thread is in submit.
+  template <typename Shader>
+  void draw(
+      Shader& shader,
+      model const& m,
+      image& rt,
+      depth_buffer& depth,
+      image const* albedo,
+      draw_info const& info);
+
+  // Executes and removes everything recorded so far. Commands are grouped by
+  // render target, then shader, then texture, and within a group run
+  // roughly front to back by the distance from the eye to the model's
+  // bounding sphere, so the hierarchical depth buffer rejects more. Draws
+  // into the same target only interact through the depth test, so the
+  // image is unchanged except where fragments tie in depth. Commands
+  // recorded during a submit go to the next one. Only one thread may submit
+  // at a time.
+  pipeline_counters submit();
+
+  // Number of commands waiting for the next submit.
+  std::size_t size() const;
+
+ private:
+  struct command {
+    void const* target;
+    void const* shader;
+    void const* texture;
+    float distance;
+    std::size_t sequence;
+    std::function<pipeline_counters()> execute;
+  };
+
+  template <typename Shader>
+  static auto set_albedo(Shader& shader, image const* texture, int)
+      -> decltype(shader.set_albedo(*texture)) {
+    if(texture) {
+      shader.set_albedo(*texture);
+    }
+  }
+
+  template <typename Shader>
+  static void set_albedo(Shader&, image const*, long) {
+  }
+
+  static float eye_distance(model const& m, draw_info const& info);
+
+  void record(command cmd);
+
+  mutable std::mutex mutex_;
+  std::vector<command> commands_;
+  std::size_t next_sequence_ = 0;
+};
+
+template <typename Shader>
+void command_buffer::draw(
+    Shader& shader,
+    model const& m,
+    image& rt,
+    depth_buffer& depth,
+    image const* albedo,
+    draw_info const& info) {
+  command cmd;
+  cmd.target   = &rt;
+  cmd.shader   = &shader;
+  cmd.texture  = albedo;
+  cmd.distance = eye_distance(m, info);
+  cmd.execute  = [&shader, &m, &rt, &depth, albedo, info]() {
+    shader.set_model(m);
+    shader.set_render_target(rt);
+    shader.set_depth(depth);
+    set_albedo(shader, albedo, 0);
+    return shader.draw(info);
+  };
+  record(std::move(cmd));
+}
+
+} // namespace swgl
+
+#endif // SWGL_COMMANDBUFFER_HPP
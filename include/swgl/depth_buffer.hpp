@@ -0,0 +1,196 @@
+//
+// swgl/depth_buffer.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_DEPTHBUFFER_HPP
+#define SWGL_DEPTHBUFFER_HPP
+#pragma once
+
+#include "swgl/lazy_clear.hpp"
+#include "swgl/simd.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace swgl {
+
+enum class depth_format {
+  // The interpolated z as is. Four bytes per pixel.
+  float32,
+  // z quantised to 24 bits, stored in the low bits of a 32 bit word like the
+  // D24X8 layout of GPUs. Four bytes per pixel, with an even precision over
+  // the whole range and a clear that is a memset.
+  unorm24,
+  // z quantised to 16 bits. Two bytes per pixel, half the memory traffic of
+  // the other formats for the clear and every depth test.
+  unorm16,
+};
+
+// Maps interpolated z values to what a format stores. Larger stored values
+// are nearer, and cleared is farther than anything encode returns, so every
+// fragment passes the depth test against a cleared buffer.
+struct float32_depth {
+  using value_type = float;
+
+  static constexpr value_type cleared = -std::numeric_limits<float>::max();
+
+  value_type encode(float z) const {
+    return z;
+  }
+
+  // encode for a vector of z values, with the results as floats.
+  simd::float_v encode(simd::float_v z) const {
+    return z;
+  }
+
+  float decode(value_type stored) const {
+    return stored;
+  }
+};
+
+// z in the depth buffer's range is spread over [1, 2^Bits - 1] and values
+// outside it are clamped. The vector encode gives exactly the integers the
+// scalar one does, as floats, which hold every value up to 2^24 exactly.
+template <typename T, int Bits>
+class unorm_depth {
+ public:
+  using value_type = T;
+
+  static constexpr value_type cleared = 0;
+
+  unorm_depth(float scale, float bias)
+      : scale_(scale)
+      , bias_(bias) {
+  }
+
+  static float largest() {
+    return static_cast<float>((1u << Bits) - 1);
+  }
+
+  value_type encode(float z) const {
+    return static_cast<value_type>(
+        std::min(std::max(z * scale_ + bias_, 1.f), largest()));
+  }
+
+  simd::float_v encode(simd::float_v z) const {
+    using simd::float_v;
+    return truncate(
+        min(max(z * float_v(scale_) + float_v(bias_), float_v(1.f)),
+            float_v(largest())));
+  }
+
+  float decode(value_type stored) const {
+    if(stored == cleared) {
+      return -std::numeric_limits<float>::max();
+    }
+    return (stored - bias_) / scale_;
+  }
+
+ private:
+  float scale_;
+  float bias_;
+};
+
+using unorm24_depth = unorm_depth<std::uint32_t, 24>;
+using unorm16_depth = unorm_depth<std::uint16_t, 16>;
+
+// A depth buffer in one of the depth_formats, for pipeline::set_depth. The
+// integer formats cover the z values from min_z to max_z, which by default
+// is the range viewport_matrix maps the view volume to.
+class depth_buffer {
+ public:
+  explicit depth_buffer(
+      int width           = 0,
+      int height          = 0,
+      depth_format format = depth_format::float32,
+      float min_z         = 0.f,
+      float max_z         = 255.f);
+
+  int width() const {
+    return width_;
+  }
+
+  int height() const {
+    return height_;
+  }
+
+  depth_format format() const {
+    return format_;
+  }
+
+  std::size_t bytes_per_pixel() const {
+    return format_ == depth_format::unorm16 ? 2 : 4;
+  }
+
+  // Range of z covered by the integer formats. Nothing stored is converted,
+  // so change it only on a cleared buffer.
+  void set_range(float min_z, float max_z);
+
+  // Scale and bias from z to the integers stored by unorm24 and unorm16.
+  float scale() const {
+    return scale_;
+  }
+
+  float bias() const {
+    return bias_;
+  }
+
+  // Sets every pixel to the farthest depth. For the integer formats that is
+  // zero, so the clear is a memset.
+  void clear();
+
+  // Clears without writing anything. Each 16x16 tile is cleared when
+  // resolve_clear first covers it, which the pipeline does for the tiles a
+  // triangle may touch, so tiles nothing is drawn to cost nothing.
+  void fast_clear() {
+    clears_.mark_all();
+  }
+
+  // Writes the pending fast clear into the tiles that overlap the inclusive
+  // rect, or into the whole buffer. Rects that share no tile may be
+  // resolved from different threads.
+  void resolve_clear(int min_x, int min_y, int max_x, int max_y);
+  void resolve_clear();
+
+  bool clear_pending() const {
+    return clears_.pending();
+  }
+
+  // width() * height() values of the format's value_type, row by row.
+  // Tiles with a pending fast clear hold stale values until resolve_clear.
+  void* data() {
+    return storage_.data();
+  }
+
+  void const* data() const {
+    return storage_.data();
+  }
+
+  // Depth of pixel (x, y) as a z value, or -FLT_MAX where nothing has been
+  // drawn. The integer formats return the bottom of the step that was
+  // stored.
+  float get(int x, int y) const;
+
+ private:
+  int width_;
+  int height_;
+  depth_format format_;
+  float scale_ = 1.f;
+  float bias_  = 0.f;
+  std::vector<std::uint32_t> storage_;
+  lazy_clear clears_;
+
+  void clear_tile(int x0, int y0, int x1, int y1);
+};
+
+} // namespace swgl
+
+#endif // SWGL_DEPTHBUFFER_HPP
@@ -0,0 +1,129 @@
+//
+// swgl/frame_manager.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_FRAMEMANAGER_HPP
+#define SWGL_FRAMEMANAGER_HPP
+#pragma once
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/pipeline_counters.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swgl {
+
+// Owns a ring of colour and depth buffers and renders into them on a worker
+// thread, so frame N + 1 is drawn while the caller is still presenting or
+// reading back frame N. A typical loop submits one frame ahead:
+//
+//   frames.submit(render);
+//   while(running) {
+//     frames.submit(render);
+//     present(*frames.acquire());
+//     frames.release();
+//   }
+//
+// Frames are rendered and acquired in submission order. Everything the
+// render function touches, such as shaders and models, is used from the
+// worker thread and must not be changed by the caller while a frame that
+// uses it is in flight.
+class frame_manager {
+ public:
+  struct frame {
+    image colour;
+    depth_buffer depth;
+    std::uint64_t number = 0;
+    pipeline_counters counters;
+  };
+
+  // Draws a frame into frame.colour and frame.depth, which have already
+  // been fast cleared, and returns the counters of the draws. Colour tiles
+  // the draws did not touch are cleared afterwards, while frame.depth keeps
+  // its pending clear, which depth_buffer::get honours.
+  using render_function = std::function<pipeline_counters(frame&)>;
+
+  frame_manager(
+      int width, int height, int bpp = image::RGB, std::size_t buffers = 2);
+  ~frame_manager();
+
+  frame_manager(frame_manager const&) = delete;
+  frame_manager& operator=(frame_manager const&) = delete;
+
+  // Sizes frames submitted from now on. Buffers are recreated by the worker
+  // as they come round, so frames in flight keep the size they were
+  // submitted with and nothing waits for them.
+  void resize(int width, int height);
+
+  int width() const;
+  int height() const;
+
+  // Colour buffers are cleared to this before each frame is rendered.
+  void set_clear_colour(image::colour_type const& c);
+
+  // Format of the depth buffers of frames submitted from now on. Defaults
+  // to float32.
+  void set_depth_format(depth_format format);
+
+  // Queues a frame for rendering. Blocks only while every buffer is either
+  // queued, being rendered or acquired.
+  void submit(render_function render);
+
+  // Waits for the oldest submitted frame to finish and hands it to the
+  // caller until release. Returns nullptr if nothing has been submitted
+  // since the last acquire. Rethrows anything thrown by the render
+  // function, after which the frame is released.
+  frame const* acquire();
+
+  // Returns the acquired frame's buffers for reuse.
+  void release();
+
+ private:
+  enum class slot_state { free, queued, rendered, acquired };
+
+  struct slot {
+    frame target;
+    render_function render;
+    image::colour_type clear_colour;
+    depth_format depth = depth_format::float32;
+    int width          = 0;
+    int height         = 0;
+    slot_state state   = slot_state::free;
+    std::exception_ptr error;
+  };
+
+  void worker_main();
+  void render(slot& s) const;
+
+  std::vector<std::unique_ptr<slot>> slots_;
+  std::size_t submit_index_  = 0;
+  std::size_t render_index_  = 0;
+  std::size_t acquire_index_ = 0;
+  std::uint64_t next_number_ = 0;
+  int width_;
+  int height_;
+  int bpp_;
+  image::colour_type clear_colour_;
+  depth_format depth_format_ = depth_format::float32;
+  mutable std::mutex mutex_;
+  std::condition_variable slot_changed_;
+  bool stop_ = false;
+  std::thread worker_;
+};
+
+} // namespace swgl
+
+#endif // SWGL_FRAMEMANAGER_HPP
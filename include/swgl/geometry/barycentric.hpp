@@ -11,38 +11,209 @@
 #pragma once
 
 #include "swgl/geometry/vector.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 
 namespace swgl {
 
+// The three edge equations of a screen space triangle, relative to its
+// first vertex. Evaluating them at a point gives the barycentric weights
+// scaled by the signed area, and since they are linear in x and y they can be
+// stepped across the raster with one add per pixel.
 class barycentric_basis {
  public:
   barycentric_basis(swgl::vector3f t0, swgl::vector3f t1, swgl::vector3f t2)
-      : root_(t0)
-      , basis_{swgl::vector3f(t2[0] - t0[0], t1[0] - t0[0], 0.f),
-               swgl::vector3f(t2[1] - t0[1], t1[1] - t0[1], 0.f)} {
+      : root_(t0.x, t0.y)
+      , step_x_(init::uninitialised)
+      , step_y_(init::uninitialised) {
+    float const e1x = t1.x - t0.x;
+    float const e1y = t1.y - t0.y;
+    float const e2x = t2.x - t0.x;
+    float const e2y = t2.y - t0.y;
+    area_           = e2x * e1y - e1x * e2y;
+    area_recip_     = degenerate() ? 0.f : 1.f / area_;
+
+    step_x_ = swgl::vector3f(e2y - e1y, -e2y, e1y);
+    step_y_ = swgl::vector3f(e1x - e2x, e2x, -e1x);
   }
 
-  swgl::vector3f compute(swgl::vector2i P) const {
-    basis_[0].z = root_.x - P.x;
-    basis_[1].z = root_.y - P.y;
+  bool degenerate() const {
+    return std::abs(area_) < 1;
+  }
+
+  float area() const {
+    return area_;
+  }
+
+  float area_recip() const {
+    return area_recip_;
+  }
 
-    swgl::vector3f u = cross(basis_[0], basis_[1]);
+  // Unnormalised weights at P.
+  swgl::vector3f edges(swgl::vector2i P) const {
+    float const dx = P.x - root_.x;
+    float const dy = P.y - root_.y;
+    return swgl::vector3f(area_, 0.f, 0.f) + step_x_ * dx + step_y_ * dy;
+  }
+
+  // Change in the unnormalised weights for a one pixel step in x or y.
+  swgl::vector3f const& step_x() const {
+    return step_x_;
+  }
 
-    if(std::abs(u[2]) < 1) {
-      // triangle is degenerate.
+  swgl::vector3f const& step_y() const {
+    return step_y_;
+  }
+
+  swgl::vector3f compute(swgl::vector2i P) const {
+    if(degenerate()) {
       return {-1, 1, 1};
     }
 
-    float zrecip = 1.f / u.z;
-    return {1.f - (u.x + u.y) * zrecip, u.y * zrecip, u.x * zrecip};
+    return edges(P) * area_recip_;
   }
 
  private:
-  swgl::vector3f root_;
-  mutable std::array<swgl::vector3f, 2> basis_;
+  swgl::vector2f root_;
+  swgl::vector3f step_x_;
+  swgl::vector3f step_y_;
+  float area_;
+  float area_recip_;
 };
 
+// Exact integer twin of barycentric_basis. Vertices are snapped to 16.8 fixed
+// point and the edge equations are evaluated at pixel centres. A top-left fill
+// rule is folded into the edges as a bias, so a pixel is covered when all
+// three biased edges are >= 0 and a pixel on an edge shared by two triangles
+// belongs to exactly one of them.
+class fixed_barycentric_basis {
+ public:
+  using edge_type = vector3<std::int64_t>;
+
+  static constexpr int subpixel_bits = 8;
+  static constexpr int subpixel_one  = 1 << subpixel_bits;
+
+  // Largest coordinate magnitude, in pixels, that fits in 16.8.
+  static constexpr float max_coordinate = 32767.f;
+
+  static bool representable(swgl::vector3f const& p) {
+    return std::abs(p.x) <= max_coordinate && std::abs(p.y) <= max_coordinate;
+  }
+
+  fixed_barycentric_basis(
+      swgl::vector3f t0, swgl::vector3f t1, swgl::vector3f t2)
+      : v_{snap(t0), snap(t1), snap(t2)} {
+    area_ = orient(v_[0], v_[1], v_[2]);
+
+    // Edge i is opposite vertex i. Normalise to a positive area so the
+    // interior is always on the positive side.
+    std::int64_t const sign = area_ < 0 ? -1 : 1;
+    area_ *= sign;
+    vector2<std::int64_t> const centre(subpixel_one / 2, subpixel_one / 2);
+    for(int i = 0; i < 3; ++i) {
+      auto const& a         = v_[(i + 1) % 3];
+      auto const& b         = v_[(i + 2) % 3];
+      std::int64_t const dx = (b.x - a.x) * sign;
+      std::int64_t const dy = (b.y - a.y) * sign;
+      origin_[i]            = orient(a, b, centre) * sign;
+      step_x_[i]            = -dy * subpixel_one;
+      step_y_[i]            = dx * subpixel_one;
+
+      // With y pointing down and a positive area, top edges run in +x and
+      // left edges run in -y.
+      bool const top_left = dy < 0 || (dy == 0 && dx > 0);
+      bias_[i]            = top_left ? 0 : -1;
+    }
+
+    area_recip_ = area_ == 0 ? 0.f : 1.f / static_cast<float>(area_);
+  }
+
+  bool degenerate() const {
+    return area_ == 0;
+  }
+
+  // Inclusive range of pixels whose centres fall in the snapped bbox.
+  vector2i min_pixel() const {
+    return vector2i(
+        pixel_lower(std::min({v_[0].x, v_[1].x, v_[2].x})),
+        pixel_lower(std::min({v_[0].y, v_[1].y, v_[2].y})));
+  }
+
+  vector2i max_pixel() const {
+    return vector2i(
+        pixel_upper(std::max({v_[0].x, v_[1].x, v_[2].x})),
+        pixel_upper(std::max({v_[0].y, v_[1].y, v_[2].y})));
+  }
+
+  // Biased edge values at the centre of pixel P.
+  edge_type edges(swgl::vector2i P) const {
+    return edge_type(
+        origin_[0] + step_x_[0] * P.x + step_y_[0] * P.y + bias_[0],
+        origin_[1] + step_x_[1] * P.x + step_y_[1] * P.y + bias_[1],
+        origin_[2] + step_x_[2] * P.x + step_y_[2] * P.y + bias_[2]);
+  }
+
+  // Change in the edges for a one pixel step in x or y.
+  edge_type const& step_x() const {
+    return step_x_;
+  }
+
+  edge_type const& step_y() const {
+    return step_y_;
+  }
+
+  static bool covered(edge_type const& e) {
+    return (e.x | e.y | e.z) >= 0;
+  }
+
+  // Normalised barycentric weights from biased edge values.
+  swgl::vector3f weights(edge_type const& e) const {
+    return swgl::vector3f(
+               static_cast<float>(e.x - bias_[0]),
+               static_cast<float>(e.y - bias_[1]),
+               static_cast<float>(e.z - bias_[2])) *
+           area_recip_;
+  }
+
+ private:
+  static vector2<std::int64_t> snap(swgl::vector3f const& p) {
+    return vector2<std::int64_t>(
+        std::llround(static_cast<double>(p.x) * subpixel_one),
+        std::llround(static_cast<double>(p.y) * subpixel_one));
+  }
+
+  static std::int64_t orient(
+      vector2<std::int64_t> const& a,
+      vector2<std::int64_t> const& b,
+      vector2<std::int64_t> const& p) {
+    return (b.x - a.x) * (p.y - a.y) - (b.y - a.y) * (p.x - a.x);
+  }
+
+  // Smallest pixel whose centre is >= v, and largest whose centre is <= v.
+  static int pixel_lower(std::int64_t v) {
+    return static_cast<int>(
+        floor_div(v - subpixel_one / 2 - 1, subpixel_one) + 1);
+  }
+
+  static int pixel_upper(std::int64_t v) {
+    return static_cast<int>(floor_div(v - subpixel_one / 2, subpixel_one));
+  }
+
+  static std::int64_t floor_div(std::int64_t a, std::int64_t b) {
+    return a >= 0 ? a / b : -((-a + b - 1) / b);
+  }
+
+  std::array<vector2<std::int64_t>, 3> v_;
+  edge_type origin_;
+  edge_type step_x_;
+  edge_type step_y_;
+  std::array<std::int64_t, 3> bias_;
+  std::int64_t area_;
+  float area_recip_;
+};
 
 } // namespace swgl
 
-#endif // SWGL_GEOMETRY_BBOX_HPP
\ No newline at end of file
+#endif // SWGL_GEOMETRY_BARYCENTRIC_HPP
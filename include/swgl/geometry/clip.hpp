@@ -0,0 +1,146 @@
+//
+// swgl/geometry/clip.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_GEOMETRY_CLIP_HPP
+#define SWGL_GEOMETRY_CLIP_HPP
+#pragma once
+
+#include "swgl/geometry/matrix.hpp"
+#include "swgl/geometry/vector.hpp"
+
+namespace swgl {
+
+// Clipping planes in the homogeneous space produced by the viewport
+// transform, where x / w and y / w are pixel coordinates. The side planes
+// are the rect [min, max] pushed out by guard_band pixels; triangles are
+// only clipped against them when they would otherwise produce coordinates
+// the rasteriser cannot handle. The projections used here have no far
+// plane, so depth is never clipped.
+class clip_volume {
+ public:
+  enum plane { near_plane, left_plane, right_plane, bottom_plane, top_plane };
+
+  static constexpr int plane_count = 5;
+
+  // Anything closer to the eye than this is behind the near plane.
+  static constexpr float near_w = 1e-3f;
+
+  clip_volume(
+      float min_x, float min_y, float max_x, float max_y, float guard_band)
+      : min_x_(min_x - guard_band)
+      , min_y_(min_y - guard_band)
+      , max_x_(max_x + guard_band)
+      , max_y_(max_y + guard_band) {
+  }
+
+  // Positive inside the plane, negative outside.
+  float distance(int plane, vector4f const& p) const {
+    switch(plane) {
+      case near_plane: return p.w - near_w;
+      case left_plane: return p.x - min_x_ * p.w;
+      case right_plane: return max_x_ * p.w - p.x;
+      case bottom_plane: return p.y - min_y_ * p.w;
+      default: return max_y_ * p.w - p.y;
+    }
+  }
+
+  // The plane as a function of a point before it was transformed by m. For
+  // p = m * (x, y, z, 1), distance(plane, p) equals
+  // f.x * x + f.y * y + f.z * z + f.w.
+  vector4f object_plane(int plane, matrix4f const& m) const {
+    vector4f k   = vector4f::zero();
+    float offset = 0.f;
+    switch(plane) {
+      case near_plane:
+        k.w    = 1.f;
+        offset = -near_w;
+        break;
+      case left_plane:
+        k.x = 1.f;
+        k.w = -min_x_;
+        break;
+      case right_plane:
+        k.x = -1.f;
+        k.w = max_x_;
+        break;
+      case bottom_plane:
+        k.y = 1.f;
+        k.w = -min_y_;
+        break;
+      default:
+        k.y = -1.f;
+        k.w = max_y_;
+        break;
+    }
+
+    vector4f f = vector4f::zero();
+    for(int j = 0; j < 4; ++j) {
+      for(int i = 0; i < 4; ++i) {
+        f[j] += k[i] * m[i][j];
+      }
+    }
+    f.w += offset;
+    return f;
+  }
+
+  // One bit per plane that p is outside of.
+  unsigned outcode(vector4f const& p) const {
+    unsigned code = 0;
+    for(int plane = 0; plane < plane_count; ++plane) {
+      if(distance(plane, p) < 0.f) {
+        code |= 1u << plane;
+      }
+    }
+    return code;
+  }
+
+ private:
+  float min_x_;
+  float min_y_;
+  float max_x_;
+  float max_y_;
+};
+
+// Clips the convex polygon in[0, count) against one plane, writing the
+// result to out and returning its vertex count, which is at most count + 1.
+// Vertices are blended with their own operator* and operator+ so every
+// attribute is interpolated along with the position. New vertices are
+// always computed from the inside end of an edge, so triangles sharing an
+// edge produce the same vertex.
+template <typename Vertex>
+int clip_polygon(
+    clip_volume const& volume,
+    int plane,
+    Vertex const* in,
+    int count,
+    Vertex* out) {
+  int n = 0;
+  for(int i = 0; i < count; ++i) {
+    Vertex const& a = in[i];
+    Vertex const& b = in[(i + 1) % count];
+    float const da  = volume.distance(plane, a.position);
+    float const db  = volume.distance(plane, b.position);
+    if(da >= 0.f) {
+      out[n++] = a;
+    }
+
+    if(da >= 0.f && db < 0.f) {
+      float const t = da / (da - db);
+      out[n++]      = a * (1.f - t) + b * t;
+    }
+    else if(da < 0.f && db >= 0.f) {
+      float const t = db / (db - da);
+      out[n++]      = b * (1.f - t) + a * t;
+    }
+  }
+  return n;
+}
+
+} // namespace swgl
+
+#endif // SWGL_GEOMETRY_CLIP_HPP
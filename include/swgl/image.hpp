@@ -11,8 +11,10 @@
 
 #include <iosfwd>
 #include <cassert>
+#include <cstddef>
 #include <cstdint>
 #include "swgl/colour.hpp"
+#include "swgl/lazy_clear.hpp"
 
 namespace swgl {
 
@@ -35,20 +37,52 @@ class image {
   bool scale(int w, int h);
   colour_type get(int x, int y) const;
   colour_type sample(float u, float v) const;
+  // Writes without checking for a pending fast clear, which would overwrite
+  // c when resolved. The pipeline resolves what it draws to; anything else
+  // must resolve_clear the pixels it sets first.
   void set(int x, int y, colour_type const& c);
   ~image();
   image& operator=(const image& img);
   int width() const;
   int height() const;
   int bytespp() const;
+  // The pixels, row by row. Tiles with a pending fast clear hold stale
+  // values, and anything written to them is lost when they are resolved,
+  // so resolve_clear or discard_clear first. Reading through the const
+  // overload asserts that no clear is pending.
+  unsigned char* data();
   unsigned char const* data() const;
   void clear();
   void clear(colour_type const& c);
+
+  // Clears to c without writing anything. Each 16x16 tile is written with
+  // c when resolve_clear first covers it, and get returns c until then.
+  void fast_clear(colour_type const& c);
+
+  // Writes the pending fast clear into the tiles that overlap the inclusive
+  // rect, or into the whole image. Rects that share no tile may be resolved
+  // from different threads.
+  void resolve_clear(int min_x, int min_y, int max_x, int max_y);
+  void resolve_clear();
+
+  // Drops a pending fast clear without writing it, for when every pixel is
+  // about to be overwritten.
+  void discard_clear();
+
+  bool clear_pending() const {
+    return clears_.pending();
+  }
+
  private:
   unsigned char* data_;
   int width_;
   int height_;
   int bytespp_;
+  colour_type clear_colour_;
+  lazy_clear clears_;
+
+  void fill(unsigned char* dst, std::size_t count, colour_type const& c);
+  void fill_tile(int x0, int y0, int x1, int y1);
 
   bool load_rle_data(std::istream& in);
   bool unload_rle_data(std::ostream& out);
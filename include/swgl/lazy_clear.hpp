@@ -0,0 +1,105 @@
+//
+// swgl/lazy_clear.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_LAZYCLEAR_HPP
+#define SWGL_LAZYCLEAR_HPP
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+namespace swgl {
+
+// Tracks which tiles of a buffer still owe a clear. A fast clear marks every
+// tile instead of writing the buffer, and each tile is written when it is
+// first touched. Tiles that nothing touches are never written.
+class lazy_clear {
+ public:
+  static constexpr int tile_size = 16;
+
+  void resize(int width, int height) {
+    width_   = width;
+    height_  = height;
+    tiles_x_ = (width + tile_size - 1) / tile_size;
+    tiles_.assign(tiles_x_ * ((height + tile_size - 1) / tile_size), 0);
+    pending_ = false;
+  }
+
+  // Marks every tile as owing a clear.
+  void mark_all() {
+    std::fill(tiles_.begin(), tiles_.end(), 1);
+    pending_ = !tiles_.empty();
+  }
+
+  // Forgets any pending clear, for when the whole buffer is overwritten.
+  void reset() {
+    if(pending_) {
+      std::fill(tiles_.begin(), tiles_.end(), 0);
+      pending_ = false;
+    }
+  }
+
+  // Whether any tile may still owe a clear.
+  bool pending() const {
+    return pending_;
+  }
+
+  bool pending(int x, int y) const {
+    return pending_ && tiles_[(y / tile_size) * tiles_x_ + x / tile_size];
+  }
+
+  // Calls fill(x0, y0, x1, y1) with the half open rect of every tile that
+  // owes a clear and overlaps the inclusive rect [min, max], and marks it
+  // done. Threads may resolve rects at the same time as long as no tile is
+  // shared between them.
+  template <typename FillFn>
+  void resolve(
+      int min_x,
+      int min_y,
+      int max_x,
+      int max_y,
+      FillFn const& fill) {
+    if(!pending_) {
+      return;
+    }
+
+    for(int ty = min_y / tile_size; ty <= max_y / tile_size; ++ty) {
+      for(int tx = min_x / tile_size; tx <= max_x / tile_size; ++tx) {
+        char& tile = tiles_[ty * tiles_x_ + tx];
+        if(tile) {
+          int const x0 = tx * tile_size;
+          int const y0 = ty * tile_size;
+          fill(
+              x0, y0, std::min(x0 + tile_size, width_),
+              std::min(y0 + tile_size, height_));
+          tile = 0;
+        }
+      }
+    }
+  }
+
+  // Resolves every tile.
+  template <typename FillFn>
+  void resolve_all(FillFn const& fill) {
+    if(pending_) {
+      resolve(0, 0, width_ - 1, height_ - 1, fill);
+      pending_ = false;
+    }
+  }
+
+ private:
+  int width_    = 0;
+  int height_   = 0;
+  int tiles_x_  = 0;
+  bool pending_ = false;
+  std::vector<char> tiles_;
+};
+
+} // namespace swgl
+
+#endif // SWGL_LAZYCLEAR_HPP
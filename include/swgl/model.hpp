@@ -9,6 +9,7 @@
 #ifndef SWGL_MODEL_HPP
 #define SWGL_MODEL_HPP
 
+#include "swgl/geometry/bbox.hpp"
 #include "swgl/geometry/vector.hpp"
 #include <array>
 #include <iosfwd>
@@ -18,6 +19,22 @@ namespace swgl {
 
 class model {
  public:
+  struct sphere {
+    vector3f centre;
+    float radius;
+  };
+
+  // Attributes of the unique vertices in structure-of-arrays form, for
+  // shaders that transform vertices in batches. Each stream is zero padded
+  // to a multiple of padding entries so whole SIMD registers can be loaded
+  // past the last vertex.
+  struct vertex_streams {
+    static constexpr int padding = 16;
+    std::array<std::vector<float>, 3> position;
+    std::array<std::vector<float>, 2> uv;
+    std::array<std::vector<float>, 3> normal;
+  };
+
   model(std::istream& in);
   ~model();
   int nverts() const;
@@ -26,6 +43,17 @@ class model {
   vector3f normal(int face, int i) const;
   vector2f uv(int face, int i) const;
 
+  // Object space bounds of all the positions, computed at load.
+  bbox<float, 3> const& bounds() const;
+  sphere const& bounding_sphere() const;
+
+  // Corners that share the same position, uv and normal indices map to the
+  // same id in [0, nunique_verts()), so per-vertex work can be shared
+  // between the faces that use them.
+  int nunique_verts() const;
+  int unique_vertex(int face, int i) const;
+  vertex_streams const& unique_vertex_streams() const;
+
  private:
   std::vector<vector3f> positions_;
   std::vector<vector3f> normals_;
@@ -33,6 +61,11 @@ class model {
   std::vector<std::array<int, 3>> idx_position_;
   std::vector<std::array<int, 3>> idx_normal_;
   std::vector<std::array<int, 3>> idx_uv_;
+  std::vector<std::array<int, 3>> idx_unique_;
+  bbox<float, 3> bounds_{vector3f::zero()};
+  sphere bounding_sphere_{vector3f::zero(), 0.f};
+  int num_unique_ = 0;
+  vertex_streams unique_streams_;
 };
 
 } // namespace swgl
@@ -0,0 +1,101 @@
+//
+// swgl/multisample_target.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_MULTISAMPLETARGET_HPP
+#define SWGL_MULTISAMPLETARGET_HPP
+#pragma once
+
+#include "swgl/colour.hpp"
+#include "swgl/geometry/vector.hpp"
+#include "swgl/image.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+namespace swgl {
+
+// Colour and depth with four samples per pixel, for anti-aliased rendering
+// through pipeline::set_multisample_target. Coverage and depth are tested
+// per sample but the fragment shader runs once per pixel and triangle, so
+// edges are smoothed for little more than the cost of a single sampled
+// render. Samples of a pixel are stored next to each other, and resolve()
+// averages them into a regular image.
+class multisample_target {
+ public:
+  using colour_type = image::colour_type;
+
+  static constexpr int sample_count = 4;
+
+  // Offset of sample s from the point a pixel is normally sampled at, in
+  // 1/16ths of a pixel. A rotated grid, so near horizontal and near vertical
+  // edges both get four distinct steps.
+  static vector2i sample_offset(int s) {
+    static int const offsets[sample_count][2] = {
+        {-2, -6}, {6, -2}, {-6, 2}, {2, 6}};
+    return vector2i(offsets[s][0], offsets[s][1]);
+  }
+
+  static constexpr int sample_offset_scale = 16;
+
+  // Largest distance of a sample from the pixel's sample point on either
+  // axis, in pixels.
+  static constexpr float sample_radius = 6.f / sample_offset_scale;
+
+  multisample_target(int width, int height);
+
+  int width() const {
+    return width_;
+  }
+
+  int height() const {
+    return height_;
+  }
+
+  // Sets every sample to c and to the farthest depth.
+  void clear(colour_type const& c);
+
+  // The sample_count depths of pixel (x, y), each row of the target being
+  // width() * sample_count floats.
+  float* depth(int x, int y) {
+    return &depth_[(y * width_ + x) * sample_count];
+  }
+
+  float const* depth(int x, int y) const {
+    return &depth_[(y * width_ + x) * sample_count];
+  }
+
+  // Writes c to the samples of (x, y) set in mask.
+  void set(int x, int y, unsigned mask, colour_type const& c) {
+    assert(x >= 0 && y >= 0 && x < width_ && y < height_);
+    colour_type* samples = &colour_[(y * width_ + x) * sample_count];
+    for(int s = 0; s < sample_count; ++s) {
+      if(mask & (1u << s)) {
+        samples[s] = c;
+      }
+    }
+  }
+
+  colour_type get(int x, int y, int s) const {
+    return colour_[(y * width_ + x) * sample_count + s];
+  }
+
+  // Averages the samples of each pixel into out, which must be the same
+  // size as the target.
+  void resolve(image& out) const;
+
+ private:
+  int width_;
+  int height_;
+  std::vector<colour_type> colour_;
+  std::vector<float> depth_;
+};
+
+} // namespace swgl
+
+#endif // SWGL_MULTISAMPLETARGET_HPP
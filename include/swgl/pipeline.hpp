@@ -10,22 +10,101 @@
 #define SWGL_PIPELINE_HPP
 #pragma once
 
+#include "swgl/depth_buffer.hpp"
 #include "swgl/geometry/barycentric.hpp"
 #include "swgl/geometry/bbox.hpp"
+#include "swgl/geometry/clip.hpp"
 #include "swgl/geometry/matrix.hpp"
 #include "swgl/image.hpp"
+#include "swgl/lazy_clear.hpp"
 #include "swgl/model.hpp"
+#include "swgl/multisample_target.hpp"
 #include "swgl/pipeline_counters.hpp"
+#include "swgl/shade_vertex_result.hpp"
+#include "swgl/simd.hpp"
+#include "swgl/thread_pool.hpp"
+#include "swgl/trace.hpp"
 
 #include <algorithm>
-#include <numeric>
 #include <array>
+#include <bitset>
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace swgl {
 
 class image;
 class model;
 
+// How triangles are turned into fragments.
+enum class raster_mode {
+  // Float edge equations sampled at integer pixel corners.
+  floating_point,
+  // Vertices snapped to 16.8 fixed point and sampled at pixel centres with a
+  // top-left fill rule, so pixels on shared edges are shaded exactly once.
+  fixed_point,
+};
+
+// Which triangles primitive setup discards by winding. Front faces are the
+// ones that wind clockwise on screen, which with y pointing down is
+// counter-clockwise in a y-up view.
+enum class cull_mode {
+  none,
+  back,
+  front,
+};
+
+// When fragments are shaded.
+enum class shading_mode {
+  // Every fragment that passes the depth test is shaded immediately.
+  forward,
+  // Visibility is resolved first, recording which triangle each pixel ends
+  // up with, and the survivors are shaded in a second pass so each pixel is
+  // shaded exactly once per draw.
+  visibility_buffer,
+};
+
+// How often the fragment shader runs. Coarse rates shade once per block of
+// pixels and broadcast the colour to every pixel of the block the triangle
+// writes, while depth is still tested per pixel.
+enum class shading_rate {
+  full,
+  coarse_2x2,
+  coarse_4x4,
+};
+
+// What the faces of the model are drawn as.
+enum class primitive_topology {
+  // Filled triangles.
+  triangle_list,
+  // The three edges of every face as one pixel wide lines. Edges shared by
+  // two faces are drawn for both.
+  line_list,
+  // The three corners of every face as single pixels.
+  point_list,
+};
+
+// Half open range of model::unique_vertex ids.
+struct vertex_range {
+  int first;
+  int last;
+};
+
+// A rect of pixels, with x and y at its top left.
+struct screen_rect {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
 class pipeline_base {
  public:
   pipeline_counters draw() const {
@@ -47,10 +126,119 @@ class pipeline : public Base {
     model_ = &m;
   }
 
-  void set_depth(std::vector<float>& depth) {
+  // The depth buffer, which must be the size of the render target. Depth is
+  // tested in the buffer's own format.
+  void set_depth(depth_buffer& depth) {
     depth_ = &depth;
   }
 
+  // Enables tiled rendering. Triangles are binned into tile_size x tile_size
+  // screen tiles which are then rasterised by the workers in the pool. Each
+  // tile is owned by exactly one worker, so the output matches the serial
+  // path exactly. Pass nullptr to go back to serial rendering.
+  void set_thread_pool(thread_pool* pool) {
+    pool_ = pool;
+  }
+
+  void set_tile_size(int tile_size) {
+    assert(tile_size > 0);
+    tile_size_ = tile_size;
+  }
+
+  void set_raster_mode(raster_mode mode) {
+    raster_mode_ = mode;
+  }
+
+  void set_cull_mode(cull_mode mode) {
+    cull_mode_ = mode;
+  }
+
+  // Lines and points are clipped to the draw rect, stepped with an integer
+  // DDA and depth tested like triangles. They are always shaded forward at
+  // the full rate, whatever the shading mode and rate, and are not culled
+  // by winding.
+  void set_topology(primitive_topology topology) {
+    topology_ = topology;
+  }
+
+  // Keeps the farthest depth of every 8x8 block of the depth buffer, so
+  // triangles and blocks that are fully behind what has already been drawn
+  // are skipped before any per-pixel work. The blocks are refreshed from the
+  // depth buffer at the start of every draw, so the caller can clear or modify
+  // it freely between draws. In tiled mode the tile size must be a multiple of
+  // the block size for it to take effect.
+  void set_hierarchical_depth(bool enable) {
+    hiz_enabled_ = enable;
+  }
+
+  // In visibility_buffer mode the shaded vertices of every triangle that
+  // survives culling are kept for the second pass, so it trades memory for
+  // fewer shade_fragment calls when there is a lot of overdraw.
+  void set_shading_mode(shading_mode mode) {
+    shading_mode_ = mode;
+  }
+
+  // Interpolates vertex outputs with perspective correction, using the 1/w
+  // the pipeline keeps in position.w after projection. Off by default, in
+  // which case attributes are interpolated linearly in screen space. Shaders
+  // that output a vector3f position have no w and are always linear.
+  void set_perspective_correction(bool enable) {
+    perspective_correction_ = enable;
+  }
+
+  void set_shading_rate(shading_rate rate) {
+    shading_rate_ = rate;
+  }
+
+  // In tiled mode, picks the shading rate of each tile in place of the one
+  // set with set_shading_rate, for example from how much detail the tile had
+  // in the previous frame. tile_x and tile_y are in units of the tile size.
+  // Called from the worker threads. Pass an empty function to go back to
+  // the per draw rate.
+  void set_tile_shading_rate(
+      std::function<shading_rate(int tile_x, int tile_y)> rate) {
+    tile_shading_rate_ = std::move(rate);
+  }
+
+  // Renders into target with multisample_target::sample_count samples per
+  // pixel, in place of the render target and depth buffer, which are
+  // ignored while it is set. Coverage and depth are tested per sample and a
+  // triangle is shaded once for each pixel it covers, at the point the pixel
+  // is sampled at without multisampling. Pass nullptr to go back to single
+  // sampled rendering.
+  void set_multisample_target(multisample_target* target) {
+    msaa_ = target;
+  }
+
+  // Limits drawing to the pixels in rect. Triangles are tested against it at
+  // setup, so nothing outside it is rasterised, shaded or written, and
+  // pipelines whose rects do not overlap can draw into the same targets from
+  // different threads without synchronising. Fast clears are resolved in
+  // lazy_clear tiles, so while one is pending on shared targets the rects
+  // must not share a tile either.
+  void set_scissor(screen_rect const& rect) {
+    scissor_         = rect;
+    scissor_enabled_ = true;
+  }
+
+  void clear_scissor() {
+    scissor_enabled_ = false;
+  }
+
+  // Draws into the part of the targets covered by rect, as if it were a
+  // whole target of its own. Shaders position vertices for a target of the
+  // viewport's size, with viewport_matrix(0, 0, rect.width, rect.height) for
+  // example, and setup moves them to the viewport's corner. Nothing outside
+  // the viewport is touched, and a scissor rect narrows that further.
+  void set_viewport(screen_rect const& rect) {
+    viewport_         = rect;
+    viewport_enabled_ = true;
+  }
+
+  void clear_viewport() {
+    viewport_enabled_ = false;
+  }
+
   model const& get_model() const {
     return *model_;
   }
@@ -61,12 +249,6 @@ class pipeline : public Base {
    public:
     using value_type = T;
 
-    T interpolate(vector3f weights) const {
-      return std::inner_product(
-          vertices_.begin() + 1, vertices_.end(), &weights.raw[1],
-          (*vertices_.begin()) * weights[0]);
-    }
-
     T& operator[](std::size_t idx) {
       return vertices_[idx];
     }
@@ -79,78 +261,2112 @@ class pipeline : public Base {
     std::array<T, 3> vertices_;
   };
 
+  // Region of the render target a triangle may touch. The bounds are
+  // inclusive.
   struct raster_info {
     int width;
     int height;
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+    // Where setup moves the positions shaders output, which are relative to
+    // the viewport.
+    int viewport_x;
+    int viewport_y;
+    bool hierarchical_depth;
+    // Depth samples per pixel, stored next to each other from depth in
+    // depth_storage. Multisampled depth is always float32.
+    int samples;
+    void* depth;
+    depth_format depth_storage;
+    float depth_scale;
+    float depth_bias;
+    // Side of the square blocks of pixels that share a fragment shader call.
+    int shading_block;
+    // Whether the targets have fast clears to resolve as triangles touch
+    // them.
+    bool resolve_clears;
   };
 
-  pipeline_counters draw_impl() const override {
-    pipeline_counters stats;
-    stats.increment_draw_count();
+  // Samples of a pixel that a triangle covers, and the ones among them that
+  // passed the depth test. Without multisampling both are always 1.
+  struct sample_coverage {
+    unsigned covered;
+    unsigned passed;
+  };
+
+  // What pass 1 of visibility buffer shading records for each sample.
+  struct visibility_sample {
+    // Position of the triangle in the list being drawn.
+    int triangle;
+    // Samples of the pixel that the triangle covers.
+    unsigned covered;
+  };
+
+  // A triangle's vertex outputs as planes in screen space, set up once per
+  // triangle in the flat float layout of the vertex output so a pixel is a
+  // couple of multiply-adds over an array the compiler can vectorise. With
+  // perspective set the planes hold the outputs multiplied by 1/w, and
+  // inv_w is the plane of 1/w itself.
+  template <typename T>
+  struct attribute_planes {
+    // The arrays are padded with zeros to whole SIMD registers so the loops
+    // need no remainder.
+    static constexpr std::size_t count = vertex_attribute_count<T>::value;
+    static constexpr std::size_t padded =
+        (count + simd::float_v::width - 1) / simd::float_v::width *
+        simd::float_v::width;
+
+    // Value at pixel P, offset from where the pixel is sampled by offset.
+    T at(vector2i P, vector2f const& offset) const {
+      float const x = static_cast<float>(P.x - base.x) + offset.x;
+      float const y = static_cast<float>(P.y - base.y) + offset.y;
+      float values[padded];
+      for(std::size_t i = 0; i < padded; ++i) {
+        values[i] = at_base[i] + dx[i] * x + dy[i] * y;
+      }
+
+      if(perspective) {
+        float const w = 1.f / (inv_w.x + inv_w.y * x + inv_w.z * y);
+        for(std::size_t i = 0; i < padded; ++i) {
+          values[i] *= w;
+        }
+      }
+
+      T value;
+      load_attributes(values, value);
+      return value;
+    }
+
+    // Value at p, in pixel coordinates where pixel P is sampled at P. Points
+    // outside the triangle are first moved onto it, so attributes such as
+    // texture coordinates are never extrapolated.
+    T at_clamped(vector2f p) const {
+      p.x -= base.x;
+      p.y -= base.y;
+      vector3f w = bc_base + bc_dx * p.x + bc_dy * p.y;
+      if(w.x < 0.f || w.y < 0.f || w.z < 0.f) {
+        w = vector3f(
+            std::max(w.x, 0.f), std::max(w.y, 0.f), std::max(w.z, 0.f));
+        w = w * (1.f / (w.x + w.y + w.z));
+        p = corner[0] * w.x + corner[1] * w.y + corner[2] * w.z;
+      }
+      return at(base, p);
+    }
+
+    vector2i base;
+    float at_base[padded] = {};
+    float dx[padded]      = {};
+    float dy[padded]      = {};
+    vector3f inv_w;
+    bool perspective;
+
+    // Barycentric weights as planes like the attributes, and the vertices
+    // relative to base.
+    vector3f bc_base;
+    vector3f bc_dx;
+    vector3f bc_dy;
+    vector2f corner[3];
+  };
+
+  static constexpr int hiz_block_size = 8;
+
+  // Triangles whose pixel range is at most this many pixels on a side take
+  // the small triangle paths in setup and rasterisation.
+  static constexpr int small_triangle_size = 2;
+
+  int target_width() const {
+    return msaa_ ? msaa_->width() : rt_->width();
+  }
+
+  int target_height() const {
+    return msaa_ ? msaa_->height() : rt_->height();
+  }
+
+  // The pixels a draw may touch: the viewport, or the whole target without
+  // one, cut down to the scissor rect.
+  screen_rect draw_rect() const {
+    int min_x = 0;
+    int min_y = 0;
+    int max_x = target_width();
+    int max_y = target_height();
+    auto const cut = [&](screen_rect const& r) {
+      min_x = std::max(min_x, r.x);
+      min_y = std::max(min_y, r.y);
+      max_x = std::min(max_x, r.x + r.width);
+      max_y = std::min(max_y, r.y + r.height);
+    };
+    if(viewport_enabled_) {
+      cut(viewport_);
+    }
+    if(scissor_enabled_) {
+      cut(scissor_);
+    }
+    return {min_x, min_y, std::max(max_x - min_x, 0),
+            std::max(max_y - min_y, 0)};
+  }
+
+  vector2i viewport_offset() const {
+    return viewport_enabled_ ? vector2i(viewport_.x, viewport_.y)
+                             : vector2i(0, 0);
+  }
+
+  raster_info full_target_raster_info() const {
+    screen_rect const rect = draw_rect();
+    vector2i const offset  = viewport_offset();
     raster_info ri;
-    ri.width           = rt_->width();
-    ri.height          = rt_->height();
-    model const& model = *model_;
-    for(int iface = 0; iface < model.nfaces(); ++iface) {
-      face<decltype(derived().shade_vertex(iface, 0))> vertex_out;
-      for(int j = 0; j < 3; j++) {
-        vertex_out[j] = derived().shade_vertex(iface, j);
+    ri.width      = target_width();
+    ri.height     = target_height();
+    ri.min_x      = rect.x;
+    ri.min_y      = rect.y;
+    ri.max_x      = rect.x + rect.width - 1;
+    ri.max_y      = rect.y + rect.height - 1;
+    ri.viewport_x = offset.x;
+    ri.viewport_y = offset.y;
+    ri.samples    = msaa_ ? multisample_target::sample_count : 1;
+    if(msaa_) {
+      ri.depth         = msaa_->depth(0, 0);
+      ri.depth_storage = depth_format::float32;
+    }
+    else {
+      assert(
+          depth_->width() == ri.width && depth_->height() == ri.height &&
+          "the depth buffer must match the render target");
+      ri.depth         = depth_->data();
+      ri.depth_storage = depth_->format();
+      ri.depth_scale   = depth_->scale();
+      ri.depth_bias    = depth_->bias();
+    }
+
+    ri.shading_block = shading_block_size(shading_rate_);
+
+    // Workers may only resolve fast clears themselves if every clear tile
+    // lies in a single screen tile.
+    ri.resolve_clears = false;
+    if(!msaa_ && (rt_->clear_pending() || depth_->clear_pending())) {
+      if(pool_ && tile_size_ % lazy_clear::tile_size != 0) {
+        rt_->resolve_clear(ri.min_x, ri.min_y, ri.max_x, ri.max_y);
+        depth_->resolve_clear(ri.min_x, ri.min_y, ri.max_x, ri.max_y);
+      }
+      else {
+        ri.resolve_clears = true;
       }
+    }
 
-      // Cull backfaces
-      auto normal = cross(
-          (vertex_out[2].position - vertex_out[0].position),
-          (vertex_out[1].position - vertex_out[0].position));
-      normal.normalize();
-      if(dot(normal, vector3f(0.f, 0.f, -1.f)) < 0.f) {
-        continue;
+    ri.hierarchical_depth =
+        hiz_enabled_ && (!pool_ || tile_size_ % hiz_block_size == 0);
+    if(ri.hierarchical_depth) {
+      int const blocks_y = (ri.height + hiz_block_size - 1) / hiz_block_size;
+      hiz_blocks_x_      = (ri.width + hiz_block_size - 1) / hiz_block_size;
+      hiz_farthest_.resize(hiz_blocks_x_ * blocks_y);
+      hiz_stale_.assign(hiz_blocks_x_ * blocks_y, 1);
+    }
+
+    if(shading_mode_ == shading_mode::visibility_buffer) {
+      visibility_.resize(ri.width * ri.height * ri.samples);
+    }
+    return ri;
+  }
+
+  // Farthest depth in the part of a block inside ri, recomputed from the
+  // depth buffer if any of it has been written since it was last computed.
+  // Pixels outside ri are never drawn, so they are not read either.
+  float hiz_farthest(raster_info const& ri, int bx, int by) const {
+    int const block = by * hiz_blocks_x_ + bx;
+    if(hiz_stale_[block]) {
+      int const x0   = std::max(bx * hiz_block_size, ri.min_x);
+      int const y0   = std::max(by * hiz_block_size, ri.min_y);
+      int const x1   = std::min((bx + 1) * hiz_block_size, ri.max_x + 1);
+      int const y1   = std::min((by + 1) * hiz_block_size, ri.max_y + 1);
+      float farthest = std::numeric_limits<float>::max();
+      for(int y = y0; y < y1; ++y) {
+        farthest = std::min(farthest, row_farthest(ri, x0, x1, y));
       }
+      hiz_farthest_[block] = farthest;
+      hiz_stale_[block]    = 0;
+    }
+    return hiz_farthest_[block];
+  }
 
-      draw_triangle(ri, vertex_out, stats);
+  // Farthest value stored in pixels [x0, x1) of row y, as a float. HiZ
+  // compares stored values, so for the integer formats this is not a z.
+  static float row_farthest(raster_info const& ri, int x0, int x1, int y) {
+    int const count = (x1 - x0) * ri.samples;
+    switch(ri.depth_storage) {
+      case depth_format::unorm24:
+        return farthest_of(depth_at<unorm24_depth>(ri, x0, y), count);
+      case depth_format::unorm16:
+        return farthest_of(depth_at<unorm16_depth>(ri, x0, y), count);
+      default:
+        return farthest_of(depth_at<float32_depth>(ri, x0, y), count);
     }
-    return stats;
   }
 
-  template <typename VertexOutput>
-  void draw_triangle(
+  template <typename T>
+  static float farthest_of(T const* first, int count) {
+    return static_cast<float>(*std::min_element(first, first + count));
+  }
+
+  // The first depth sample of pixel (x, y).
+  template <typename Encoding>
+  static typename Encoding::value_type* depth_at(
+      raster_info const& ri, int x, int y) {
+    return static_cast<typename Encoding::value_type*>(ri.depth) +
+           (y * ri.width + x) * ri.samples;
+  }
+
+  // Calls fn with the encoding of the depth buffer ri draws into.
+  template <typename Fn>
+  static void with_depth_encoding(raster_info const& ri, Fn const& fn) {
+    switch(ri.depth_storage) {
+      case depth_format::unorm24:
+        fn(unorm24_depth(ri.depth_scale, ri.depth_bias));
+        break;
+      case depth_format::unorm16:
+        fn(unorm16_depth(ri.depth_scale, ri.depth_bias));
+        break;
+      default:
+        fn(float32_depth());
+        break;
+    }
+  }
+
+  // Calls draw_block(x0, y0, x1, y1) for the parts of the inclusive rect
+  // [min, max] that might be visible. nearest(x0, y0, x1, y1) must return an
+  // upper bound on the depth of any fragment the triangle produces in a
+  // rect, encoded like the depth buffer, and draw_block returns whether it
+  // wrote any depth.
+  template <typename NearestFn, typename DrawBlockFn>
+  void visit_blocks(
       raster_info const& ri,
-      VertexOutput const& tri,
+      int min_x,
+      int min_y,
+      int max_x,
+      int max_y,
+      NearestFn const& nearest,
+      DrawBlockFn const& draw_block,
       pipeline_counters& stats) const {
-    stats.increment_triangle_count();
-    auto& depth = *depth_;
-    swgl::bbox<float, 3> box(tri[0].position);
-    box.expand(tri[1].position);
-    box.expand(tri[2].position);
-    box.clamp({0.f, 0.f, 0.f}, vector3f(ri.width - 1.f, ri.height - 1.f, 0.f));
-    auto bboxmin = box.min();
-    auto bboxmax = box.max();
-    vector2i P;
-    barycentric_basis barycentric(
-        tri[0].position, tri[1].position, tri[2].position);
-    for(P.x = static_cast<int>(bboxmin.x); P.x <= bboxmax.x; P.x++) {
-      for(P.y = static_cast<int>(bboxmin.y); P.y <= bboxmax.y; P.y++) {
-        vector3f bc_screen = barycentric.compute(P);
-        if(bc_screen.x < 0 || bc_screen.y < 0 || bc_screen.z < 0)
+    if(!ri.hierarchical_depth) {
+      draw_block(min_x, min_y, max_x, max_y);
+      return;
+    }
+
+    int const bx0 = min_x / hiz_block_size;
+    int const by0 = min_y / hiz_block_size;
+    int const bx1 = max_x / hiz_block_size;
+    int const by1 = max_y / hiz_block_size;
+
+    // Small triangles touch a handful of pixels, which is cheaper to test
+    // directly than the blocks around them.
+    if(max_x - min_x < small_triangle_size &&
+       max_y - min_y < small_triangle_size) {
+      if(draw_block(min_x, min_y, max_x, max_y)) {
+        for(int by = by0; by <= by1; ++by) {
+          for(int bx = bx0; bx <= bx1; ++bx) {
+            hiz_stale_[by * hiz_blocks_x_ + bx] = 1;
+          }
+        }
+      }
+      return;
+    }
+
+    float farthest = std::numeric_limits<float>::max();
+    for(int by = by0; by <= by1; ++by) {
+      for(int bx = bx0; bx <= bx1; ++bx) {
+        farthest = std::min(farthest, hiz_farthest(ri, bx, by));
+      }
+    }
+
+    if(nearest(min_x, min_y, max_x, max_y) <= farthest) {
+      stats.increment_occluded_triangle_count();
+      return;
+    }
+
+    for(int by = by0; by <= by1; ++by) {
+      int const y0 = std::max(by * hiz_block_size, min_y);
+      int const y1 = std::min(by * hiz_block_size + hiz_block_size - 1, max_y);
+      for(int bx = bx0; bx <= bx1; ++bx) {
+        int const x0 = std::max(bx * hiz_block_size, min_x);
+        int const x1 =
+            std::min(bx * hiz_block_size + hiz_block_size - 1, max_x);
+        if(nearest(x0, y0, x1, y1) <= hiz_farthest(ri, bx, by)) {
+          stats.increment_occluded_block_count();
           continue;
-        float Z = 0;
-        for(int k = 0; k < 3; ++k) {
-          Z += tri[k].position.z * bc_screen[k];
         }
-        int depth_idx = static_cast<int>(P.y * ri.width + P.x);
-        if(Z > depth[depth_idx]) {
-          depth[depth_idx] = Z;
-          stats.increment_pixel_count();
-          colour<float> lighted =
-              derived().shade_fragment(tri.interpolate(bc_screen));
-
-          if(lighted.a() > 0.f) {
-            rt_->set(
-                static_cast<int>(P.x), static_cast<int>(P.y),
-                colour_cast<std::uint8_t>(lighted));
+
+        if(draw_block(x0, y0, x1, y1)) {
+          hiz_stale_[by * hiz_blocks_x_ + bx] = 1;
+        }
+      }
+    }
+  }
+
+  // Pads a depth bound to cover rounding in the interpolated depth.
+  static float conservative_nearest(float z, float z_magnitude) {
+    return z + std::max(z_magnitude, 1.f) * 1e-5f;
+  }
+
+  // Shaded vertices of the current draw, indexed by model::unique_vertex.
+  // Empty when the shader has not opted in to caching.
+  template <typename VertexOutput>
+  struct vertex_cache {
+    std::vector<VertexOutput> vertices;
+    std::vector<char> shaded;
+  };
+
+  // A shader opts in to the vertex cache by declaring
+  //
+  //   static constexpr bool cache_vertices = true;
+  //
+  // which promises that shade_vertex(face, i) only depends on the position,
+  // uv and normal of that corner and not on the rest of the face.
+  template <typename D>
+  static constexpr bool uses_vertex_cache(decltype(D::cache_vertices)*) {
+    return D::cache_vertices;
+  }
+
+  template <typename D>
+  static constexpr bool uses_vertex_cache(...) {
+    return false;
+  }
+
+  // Shaders that cache vertices can also provide
+  //
+  //   void shade_vertices(vertex_range range, vertex_out* out) const;
+  //
+  // which shades the unique vertices in range into out[0, range size),
+  // reading their attributes from model::unique_vertex_streams so that it
+  // can work on several vertices at once. The whole cache is then filled up
+  // front in batches of vertex_batch_size, spread over the thread pool when
+  // there is one.
+  template <typename D, typename VertexOutput>
+  static constexpr bool uses_batched_vertices(
+      decltype(std::declval<D const&>().shade_vertices(
+          std::declval<vertex_range>(), std::declval<VertexOutput*>()))*) {
+    return uses_vertex_cache<D>(nullptr);
+  }
+
+  template <typename D, typename VertexOutput>
+  static constexpr bool uses_batched_vertices(...) {
+    return false;
+  }
+
+  static constexpr int vertex_batch_size = 256;
+
+  template <typename VertexOutput>
+  vertex_cache<VertexOutput> make_vertex_cache(
+      pipeline_counters& stats) const {
+    vertex_cache<VertexOutput> cache;
+    if(uses_vertex_cache<Derived>(nullptr)) {
+      cache.vertices.resize(model_->nunique_verts());
+      cache.shaded.assign(model_->nunique_verts(), 0);
+      shade_vertex_batches(
+          cache, stats,
+          std::integral_constant<
+              bool, uses_batched_vertices<Derived, VertexOutput>(nullptr)>());
+    }
+    return cache;
+  }
+
+  template <typename VertexOutput>
+  void shade_vertex_batches(
+      vertex_cache<VertexOutput>&, pipeline_counters&, std::false_type) const {
+  }
+
+  template <typename VertexOutput>
+  void shade_vertex_batches(
+      vertex_cache<VertexOutput>& cache,
+      pipeline_counters& stats,
+      std::true_type) const {
+    SWGL_TRACE_SCOPE("vertex shading", "stage");
+    stage_timer const timer(stats, pipeline_stage::vertex_shading);
+    int const count  = static_cast<int>(cache.vertices.size());
+    auto shade_batch = [&](std::size_t, std::size_t batch) {
+      SWGL_TRACE_SCOPE("vertex batch", "worker", "batch", batch);
+      vertex_range range;
+      range.first = static_cast<int>(batch) * vertex_batch_size;
+      range.last  = std::min(range.first + vertex_batch_size, count);
+      derived().shade_vertices(range, &cache.vertices[range.first]);
+    };
+
+    std::size_t const batches =
+        (count + vertex_batch_size - 1) / vertex_batch_size;
+    if(pool_) {
+      pool_->parallel_for(batches, shade_batch);
+    }
+    else {
+      for(std::size_t batch = 0; batch < batches; ++batch) {
+        shade_batch(0, batch);
+      }
+    }
+
+    cache.shaded.assign(count, 1);
+    stats.add_vertex_shader_count(count);
+  }
+
+  template <typename VertexOutput>
+  void shade_face(
+      int iface,
+      face<VertexOutput>& vertex_out,
+      vertex_cache<VertexOutput>& cache,
+      pipeline_counters& stats) const {
+    stage_timer const timer(stats, pipeline_stage::vertex_shading);
+    for(int j = 0; j < 3; j++) {
+      if(cache.shaded.empty()) {
+        stats.increment_vertex_shader_count();
+        vertex_out[j] = derived().shade_vertex(iface, j);
+        continue;
+      }
+
+      int const v = model_->unique_vertex(iface, j);
+      if(cache.shaded[v]) {
+        stats.increment_vertex_cache_hit_count();
+      }
+      else {
+        stats.increment_vertex_shader_count();
+        cache.vertices[v] = derived().shade_vertex(iface, j);
+        cache.shaded[v]   = 1;
+      }
+      vertex_out[j] = cache.vertices[v];
+    }
+  }
+
+  // Shaders can output a homogeneous vector4f position from shade_vertex,
+  // in which case the pipeline clips and divides by w. The projected vertex
+  // keeps 1/w in position.w. Shaders that output a vector3f position have
+  // already done the divide and are not clipped.
+  template <typename VertexOutput>
+  using homogeneous_position = std::is_same<
+      typename std::decay<decltype(
+          std::declval<VertexOutput const&>().position)>::type,
+      vector4f>;
+
+  static vector3f const& screen_position(vector3f const& p) {
+    return p;
+  }
+
+  static vector3f screen_position(vector4f const& p) {
+    return vector_narrow<3>(p);
+  }
+
+  static float inverse_w(vector3f const&) {
+    return 1.f;
+  }
+
+  static float inverse_w(vector4f const& p) {
+    return p.w;
+  }
+
+  // How far past the render target triangles may extend before they are
+  // clipped against its sides. Large enough that few triangles need it,
+  // small enough to keep coordinates within fixed_barycentric_basis range.
+  static constexpr float clip_guard_band = 4096.f;
+
+  // Calls emit(tri) for each projected, front facing triangle that tri
+  // produces.
+  template <typename VertexOutput, typename EmitFn>
+  void clip_and_cull(
+      raster_info const& ri,
+      face<VertexOutput> const& tri,
+      pipeline_counters& stats,
+      EmitFn const& emit) const {
+    stage_timer const timer(stats, pipeline_stage::setup);
+    if(ri.viewport_x != 0 || ri.viewport_y != 0) {
+      face<VertexOutput> moved = tri;
+      for(int j = 0; j < 3; ++j) {
+        move_to_viewport(ri, moved[j].position);
+      }
+      clip_and_cull(
+          ri, moved, stats, emit, homogeneous_position<VertexOutput>());
+      return;
+    }
+
+    clip_and_cull(
+        ri, tri, stats, emit, homogeneous_position<VertexOutput>());
+  }
+
+  static void move_to_viewport(raster_info const& ri, vector3f& p) {
+    p.x += ri.viewport_x;
+    p.y += ri.viewport_y;
+  }
+
+  // Before the divide, so the offset is scaled by w.
+  static void move_to_viewport(raster_info const& ri, vector4f& p) {
+    p.x += ri.viewport_x * p.w;
+    p.y += ri.viewport_y * p.w;
+  }
+
+  template <typename VertexOutput, typename EmitFn>
+  void clip_and_cull(
+      raster_info const& ri,
+      face<VertexOutput> const& tri,
+      pipeline_counters& stats,
+      EmitFn const& emit,
+      std::false_type) const {
+    setup_triangle(ri, tri, stats, emit);
+  }
+
+  template <typename VertexOutput, typename EmitFn>
+  void clip_and_cull(
+      raster_info const& ri,
+      face<VertexOutput> const& tri,
+      pipeline_counters& stats,
+      EmitFn const& emit,
+      std::true_type) const {
+    // Trivially reject triangles that are entirely outside one side of the
+    // pixels being drawn or behind the near plane. Multisampled pixels have
+    // samples up to sample_radius before the float rasteriser's sample point.
+    float const r = ri.samples > 1 ? multisample_target::sample_radius : 0.f;
+    clip_volume const target(
+        ri.min_x - r, ri.min_y - r, ri.max_x + 1.f, ri.max_y + 1.f, 0.f);
+    if(target.outcode(tri[0].position) & target.outcode(tri[1].position) &
+       target.outcode(tri[2].position)) {
+      stats.increment_frustum_culled_triangle_count();
+      return;
+    }
+
+    clip_volume const guard_band(
+        ri.min_x, ri.min_y, ri.max_x + 1.f, ri.max_y + 1.f, clip_guard_band);
+    unsigned const crossing = guard_band.outcode(tri[0].position) |
+                              guard_band.outcode(tri[1].position) |
+                              guard_band.outcode(tri[2].position);
+    if(!crossing) {
+      face<VertexOutput> projected = tri;
+      for(int j = 0; j < 3; ++j) {
+        project(projected[j]);
+      }
+      setup_triangle(ri, projected, stats, emit);
+      return;
+    }
+
+    stats.increment_clipped_triangle_count();
+    VertexOutput polygon[2][3 + clip_volume::plane_count];
+    std::copy(&tri[0], &tri[0] + 3, polygon[0]);
+    int count = 3;
+    int src   = 0;
+    for(int plane = 0; plane < clip_volume::plane_count; ++plane) {
+      if(crossing & (1u << plane)) {
+        count = clip_polygon(
+            guard_band, plane, polygon[src], count, polygon[src ^ 1]);
+        src ^= 1;
+      }
+    }
+
+    for(int i = 0; i < count; ++i) {
+      project(polygon[src][i]);
+    }
+
+    for(int i = 1; i + 1 < count; ++i) {
+      face<VertexOutput> piece;
+      piece[0] = polygon[src][0];
+      piece[1] = polygon[src][i];
+      piece[2] = polygon[src][i + 1];
+      setup_triangle(ri, piece, stats, emit);
+    }
+  }
+
+  template <typename VertexOutput>
+  static void project(VertexOutput& v) {
+    float const rw = 1.f / v.position.w;
+    v.position     = vector4f(
+        v.position.x * rw, v.position.y * rw, v.position.z * rw, rw);
+  }
+
+  // Primitive setup. Discards triangles that are culled by winding or that
+  // cannot produce a fragment, before they are binned or rasterised.
+  template <typename VertexOutput, typename EmitFn>
+  void setup_triangle(
+      raster_info const& ri,
+      face<VertexOutput> const& tri,
+      pipeline_counters& stats,
+      EmitFn const& emit) const {
+    vector3f const a = screen_position(tri[0].position);
+    vector3f const b = screen_position(tri[1].position);
+    vector3f const c = screen_position(tri[2].position);
+
+    // Twice the signed screen area, positive for front faces. This is
+    // exactly the negated area of barycentric_basis, so the float threshold
+    // matches barycentric_basis::degenerate.
+    float const area =
+        (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+
+    bool const fixed     = uses_fixed_point(a, b, c);
+    float const min_area = fixed ? std::numeric_limits<float>::min() : 1.f;
+    if(!(std::abs(area) >= min_area)) {
+      stats.increment_degenerate_triangle_count();
+      return;
+    }
+
+    if((cull_mode_ == cull_mode::back && area < 0.f) ||
+       (cull_mode_ == cull_mode::front && area > 0.f)) {
+      stats.increment_facing_culled_triangle_count();
+      return;
+    }
+
+    if(fixed ? !covers_sample_fixed(ri, a, b, c)
+             : !covers_sample(ri, a, b, c)) {
+      stats.increment_missed_triangle_count();
+      return;
+    }
+
+    stats.increment_triangle_count();
+    emit(tri);
+  }
+
+  bool uses_fixed_point(
+      vector3f const& a, vector3f const& b, vector3f const& c) const {
+    return raster_mode_ == raster_mode::fixed_point &&
+           fixed_barycentric_basis::representable(a) &&
+           fixed_barycentric_basis::representable(b) &&
+           fixed_barycentric_basis::representable(c);
+  }
+
+  // The float rasteriser samples at integer pixel coordinates, so a
+  // triangle whose bbox holds none of the ones in ri covers nothing.
+  // Multisampled pixels also have samples up to sample_radius either side.
+  static bool covers_sample(
+      raster_info const& ri,
+      vector3f const& a,
+      vector3f const& b,
+      vector3f const& c) {
+    float const r = ri.samples > 1 ? multisample_target::sample_radius : 0.f;
+    vector2f const lo(ri.min_x, ri.min_y);
+    vector2f const hi(ri.max_x, ri.max_y);
+    float const min_x =
+        std::max(std::ceil(std::min({a.x, b.x, c.x}) - r), lo.x);
+    float const min_y =
+        std::max(std::ceil(std::min({a.y, b.y, c.y}) - r), lo.y);
+    float const max_x =
+        std::min(std::floor(std::max({a.x, b.x, c.x}) + r), hi.x);
+    float const max_y =
+        std::min(std::floor(std::max({a.y, b.y, c.y}) + r), hi.y);
+    return min_x <= max_x && min_y <= max_y;
+  }
+
+  // The fixed point rasteriser samples at pixel centres. Edges are exact, so
+  // small triangles can be tested against each sample they might cover with
+  // the same result the rasteriser would get.
+  static bool covers_sample_fixed(
+      raster_info const& ri,
+      vector3f const& a,
+      vector3f const& b,
+      vector3f const& c) {
+    fixed_barycentric_basis const barycentric(a, b, c);
+    if(barycentric.degenerate()) {
+      return false;
+    }
+
+    // Samples of a multisampled pixel can reach into the pixels either side
+    // of the ones whose centres are covered.
+    int const grow      = ri.samples > 1 ? 1 : 0;
+    vector2i const pmin = barycentric.min_pixel();
+    vector2i const pmax = barycentric.max_pixel();
+    int const min_x     = std::max(pmin.x - grow, ri.min_x);
+    int const min_y     = std::max(pmin.y - grow, ri.min_y);
+    int const max_x     = std::min(pmax.x + grow, ri.max_x);
+    int const max_y     = std::min(pmax.y + grow, ri.max_y);
+    if(min_x > max_x || min_y > max_y) {
+      return false;
+    }
+
+    if(max_x - min_x >= small_triangle_size + 2 * grow ||
+       max_y - min_y >= small_triangle_size + 2 * grow) {
+      return true;
+    }
+
+    for(int y = min_y; y <= max_y; ++y) {
+      for(int x = min_x; x <= max_x; ++x) {
+        auto const e = barycentric.edges(vector2i(x, y));
+        for(int s = 0; s < ri.samples; ++s) {
+          if(fixed_barycentric_basis::covered(
+                 e + fixed_sample_offset(ri, barycentric, s))) {
+            return true;
           }
         }
       }
     }
+    return false;
+  }
+
+  // Change in the fixed point edges from a pixel's centre to its sample s.
+  static fixed_barycentric_basis::edge_type fixed_sample_offset(
+      raster_info const& ri,
+      fixed_barycentric_basis const& barycentric,
+      int s) {
+    if(ri.samples == 1) {
+      return fixed_barycentric_basis::edge_type(0, 0, 0);
+    }
+
+    // Steps are whole multiples of the subpixel size, so this is exact.
+    vector2i const o         = multisample_target::sample_offset(s);
+    std::int64_t const scale = multisample_target::sample_offset_scale;
+    auto const e = barycentric.step_x() * o.x + barycentric.step_y() * o.y;
+    return fixed_barycentric_basis::edge_type(
+        e.x / scale, e.y / scale, e.z / scale);
+  }
+
+  // Bases that provide object_to_screen() get whole draws culled when the
+  // model's bounds are entirely outside the draw rect or behind the near
+  // plane.
+  template <typename D>
+  static constexpr bool has_object_to_screen(
+      typename std::decay<decltype(
+          std::declval<D const&>().object_to_screen())>::type*) {
+    return true;
+  }
+
+  template <typename D>
+  static constexpr bool has_object_to_screen(...) {
+    return false;
+  }
+
+  bool draw_culled() const {
+    return draw_culled(
+        std::integral_constant<bool, has_object_to_screen<Derived>(nullptr)>());
+  }
+
+  bool draw_culled(std::false_type) const {
+    return false;
+  }
+
+  bool draw_culled(std::true_type) const {
+    // object_to_screen maps into the viewport, before setup moves it.
+    matrix4f const& m      = derived().object_to_screen();
+    screen_rect const rect = draw_rect();
+    vector2i const offset  = viewport_offset();
+    clip_volume const target(
+        rect.x - offset.x, rect.y - offset.y,
+        rect.x + rect.width - offset.x, rect.y + rect.height - offset.y, 0.f);
+
+    // The sphere is a few dot products per plane; the box corners catch
+    // models that the sphere overestimates.
+    model::sphere const& sphere = model_->bounding_sphere();
+    vector3f const& c           = sphere.centre;
+    for(int plane = 0; plane < clip_volume::plane_count; ++plane) {
+      vector4f const f = target.object_plane(plane, m);
+      float const d    = f.x * c.x + f.y * c.y + f.z * c.z + f.w;
+      if(d < -sphere.radius * std::sqrt(f.x * f.x + f.y * f.y + f.z * f.z)) {
+        return true;
+      }
+    }
+
+    vector3f const lo = model_->bounds().min();
+    vector3f const hi = model_->bounds().max();
+    unsigned outside  = ~0u;
+    for(int corner = 0; corner < 8; ++corner) {
+      vector3f const p(
+          corner & 1 ? hi.x : lo.x, corner & 2 ? hi.y : lo.y,
+          corner & 4 ? hi.z : lo.z);
+      outside &= target.outcode(m * vector_widen<4>(p, 1.f));
+    }
+    return outside != 0;
+  }
+
+  // Shaders' own draw calls come straight here, so the draw span is
+  // recorded here rather than in pipeline_base::draw.
+  pipeline_counters draw_impl() const override {
+    SWGL_TRACE_SCOPE("draw", "pipeline");
+    screen_rect const rect = draw_rect();
+    if(rect.width == 0 || rect.height == 0 || draw_culled()) {
+      pipeline_counters stats;
+      stats.increment_draw_count();
+      stats.increment_culled_draw_count();
+      return stats;
+    }
+
+    if(topology_ != primitive_topology::triangle_list) {
+      return draw_lines_and_points();
+    }
+
+    if(pool_) {
+      return draw_tiled(*pool_);
+    }
+
+    if(shading_mode_ == shading_mode::visibility_buffer) {
+      return draw_deferred();
+    }
+
+    using vertex_type = decltype(derived().shade_vertex(0, 0));
+
+    pipeline_counters stats;
+    stats.increment_draw_count();
+    raster_info ri     = full_target_raster_info();
+    model const& model = *model_;
+    auto cache         = make_vertex_cache<vertex_type>(stats);
+    SWGL_TRACE_SCOPE("forward", "stage");
+    for(int iface = 0; iface < model.nfaces(); ++iface) {
+      face<vertex_type> vertex_out;
+      shade_face(iface, vertex_out, cache, stats);
+      clip_and_cull(ri, vertex_out, stats, [&](face<vertex_type> const& tri) {
+        draw_triangle(ri, tri, stats);
+      });
+    }
+    return stats;
+  }
+
+  // Serial visibility buffer path; the whole target is treated as one tile.
+  pipeline_counters draw_deferred() const {
+    using vertex_type = decltype(derived().shade_vertex(0, 0));
+    using face_type   = face<vertex_type>;
+
+    pipeline_counters stats;
+    stats.increment_draw_count();
+    raster_info const ri = full_target_raster_info();
+    model const& model   = *model_;
+    std::vector<face_type> triangles;
+    triangles.reserve(model.nfaces());
+    auto cache = make_vertex_cache<vertex_type>(stats);
+    tile_bins_.resize(1);
+    tile_bins_[0].clear();
+    {
+      SWGL_TRACE_SCOPE("geometry", "stage");
+      for(int iface = 0; iface < model.nfaces(); ++iface) {
+        face_type vertex_out;
+        shade_face(iface, vertex_out, cache, stats);
+        clip_and_cull(ri, vertex_out, stats, [&](face_type const& tri) {
+          tile_bins_[0].push_back(static_cast<int>(triangles.size()));
+          triangles.push_back(tri);
+        });
+      }
+    }
+
+    draw_visibility(ri, triangles, tile_bins_[0], stats);
+    return stats;
+  }
+
+  // Pass 1 resolves visibility for the triangles listed in indices within
+  // ri, pass 2 shades whatever each pixel ended up with.
+  template <typename Face>
+  void draw_visibility(
+      raster_info const& ri,
+      std::vector<Face> const& triangles,
+      std::vector<int> const& indices,
+      pipeline_counters& stats) const {
+    if(indices.empty()) {
+      return;
+    }
+
+    SWGL_TRACE_SCOPE("visibility buffer", "stage");
+    stage_timer const timer(stats, pipeline_stage::rasterisation);
+    for(int y = ri.min_y; y <= ri.max_y; ++y) {
+      visibility_sample* row = &visibility_[y * ri.width * ri.samples];
+      for(int x = ri.min_x * ri.samples; x < (ri.max_x + 1) * ri.samples;
+          ++x) {
+        row[x].triangle = -1;
+      }
+    }
+
+    int const count = static_cast<int>(indices.size());
+    for(int i = 0; i < count; ++i) {
+      rasterise(
+          ri, triangles[indices[i]], stats,
+          [&](vector2i P, sample_coverage const& coverage) {
+            visibility_sample* pixel =
+                &visibility_[(P.y * ri.width + P.x) * ri.samples];
+            for(int s = 0; s < ri.samples; ++s) {
+              if(coverage.passed & (1u << s)) {
+                pixel[s].triangle = i;
+                pixel[s].covered  = coverage.covered;
+              }
+            }
+          });
+    }
+
+    // Attributes are only set up for triangles that kept a sample, and each
+    // triangle is shaded once per pixel for all the samples it kept there.
+    SWGL_TRACE_SCOPE("shading", "stage");
+    using vertex_type = typename Face::value_type;
+    std::vector<attribute_planes<vertex_type>> planes(count);
+    std::vector<char> planes_ready(count, 0);
+    coarse_cache<1024> cache;
+    for(int y = ri.min_y; y <= ri.max_y; ++y) {
+      for(int x = ri.min_x; x <= ri.max_x; ++x) {
+        visibility_sample const* pixel =
+            &visibility_[(y * ri.width + x) * ri.samples];
+        unsigned shaded = 0;
+        for(int s = 0; s < ri.samples; ++s) {
+          int const i = pixel[s].triangle;
+          if(i < 0 || (shaded & (1u << s))) {
+            continue;
+          }
+
+          sample_coverage coverage = {pixel[s].covered, 0};
+          for(int t = s; t < ri.samples; ++t) {
+            if(pixel[t].triangle == i) {
+              coverage.passed |= 1u << t;
+            }
+          }
+          shaded |= coverage.passed;
+
+          if(!planes_ready[i]) {
+            planes[i]       = setup_attributes(triangles[indices[i]], stats);
+            planes_ready[i] = 1;
+          }
+
+          vector2i const P(x, y);
+          if(ri.shading_block > 1) {
+            auto& block = cache.find(ri, P, i);
+            if(!block.shaded) {
+              block.kept = shade(
+                  planes[i].at_clamped(block_centre(ri, P)), block.colour,
+                  stats);
+              block.shaded = true;
+            }
+            if(block.kept) {
+              write_pixel(P, block.colour, coverage, stats);
+            }
+            continue;
+          }
+
+          vector2f const offset = shading_offset(ri, coverage);
+          shade_pixel(P, planes[i].at(P, offset), coverage, stats);
+        }
+      }
+    }
+  }
+
+  pipeline_counters draw_tiled(thread_pool& pool) const {
+    using vertex_type = decltype(derived().shade_vertex(0, 0));
+    using face_type   = face<vertex_type>;
+
+    pipeline_counters stats;
+    stats.increment_draw_count();
+    raster_info const ri = full_target_raster_info();
+
+    // Front end: shade and cull on the calling thread, keeping submission
+    // order so every tile sees its triangles in the same order as the serial
+    // path.
+    model const& model = *model_;
+    std::vector<face_type> triangles;
+    triangles.reserve(model.nfaces());
+    auto cache = make_vertex_cache<vertex_type>(stats);
+    {
+      SWGL_TRACE_SCOPE("geometry", "stage");
+      for(int iface = 0; iface < model.nfaces(); ++iface) {
+        face_type vertex_out;
+        shade_face(iface, vertex_out, cache, stats);
+        clip_and_cull(ri, vertex_out, stats, [&](face_type const& tri) {
+          triangles.push_back(tri);
+        });
+      }
+    }
+
+    draw_binned(
+        pool, ri, triangles.size(),
+        [&](std::size_t i, vector2i& pmin, vector2i& pmax) {
+          auto box     = screen_bbox(ri, triangles[i]);
+          auto bboxmin = box.min();
+          auto bboxmax = box.max();
+          if(bboxmin.x > bboxmax.x || bboxmin.y > bboxmax.y) {
+            return false;
+          }
+
+          pmin = vector2i(
+              static_cast<int>(bboxmin.x), static_cast<int>(bboxmin.y));
+          pmax = vector2i(
+              static_cast<int>(bboxmax.x), static_cast<int>(bboxmax.y));
+          return true;
+        },
+        [&](raster_info const& tile_ri, std::vector<int> const& bin,
+            pipeline_counters& tile_stats) {
+          if(shading_mode_ == shading_mode::visibility_buffer) {
+            draw_visibility(tile_ri, triangles, bin, tile_stats);
+            return;
+          }
+
+          for(int idx : bin) {
+            draw_triangle(tile_ri, triangles[idx], tile_stats);
+          }
+        },
+        stats);
+    return stats;
+  }
+
+  // Bins count primitives into the screen tiles they overlap and has the
+  // pool draw every tile, with counters kept per worker and merged into
+  // stats after. bounds(i, pmin, pmax) sets the inclusive pixel bounds of
+  // primitive i, or returns false if it has none, and draw(tile_ri, bin,
+  // stats) draws the primitives listed in bin, in submission order, within
+  // tile_ri. Only the tiles that overlap the draw rect are visited.
+  template <typename BoundsFn, typename DrawFn>
+  void draw_binned(
+      thread_pool& pool,
+      raster_info const& ri,
+      std::size_t count,
+      BoundsFn const& bounds,
+      DrawFn const& draw,
+      pipeline_counters& stats) const {
+    int const tile_x0 = ri.min_x / tile_size_;
+    int const tile_y0 = ri.min_y / tile_size_;
+    int const tiles_x = ri.max_x / tile_size_ - tile_x0 + 1;
+    int const tiles_y = ri.max_y / tile_size_ - tile_y0 + 1;
+    tile_bins_.resize(tiles_x * tiles_y);
+    for(auto& bin : tile_bins_) {
+      bin.clear();
+    }
+
+    {
+      SWGL_TRACE_SCOPE("binning", "stage");
+      stage_timer const timer(stats, pipeline_stage::setup);
+      for(std::size_t i = 0; i < count; ++i) {
+        vector2i pmin;
+        vector2i pmax;
+        if(!bounds(i, pmin, pmax)) {
+          continue;
+        }
+
+        int const x0 = std::max(pmin.x, ri.min_x);
+        int const y0 = std::max(pmin.y, ri.min_y);
+        int const x1 = std::min(pmax.x, ri.max_x);
+        int const y1 = std::min(pmax.y, ri.max_y);
+        if(x0 > x1 || y0 > y1) {
+          continue;
+        }
+
+        for(int ty = y0 / tile_size_; ty <= y1 / tile_size_; ++ty) {
+          for(int tx = x0 / tile_size_; tx <= x1 / tile_size_; ++tx) {
+            tile_bins_[(ty - tile_y0) * tiles_x + tx - tile_x0].push_back(
+                static_cast<int>(i));
+          }
+        }
+      }
+    }
+
+    SWGL_TRACE_SCOPE("tiles", "stage");
+    std::vector<pipeline_counters> worker_stats(pool.size());
+    pool.parallel_for(
+        tile_bins_.size(), [&](std::size_t worker, std::size_t tile) {
+          SWGL_TRACE_SCOPE("tile", "worker", "tile", tile);
+          int const tx        = static_cast<int>(tile) % tiles_x + tile_x0;
+          int const ty        = static_cast<int>(tile) / tiles_x + tile_y0;
+          raster_info tile_ri = ri;
+          tile_ri.min_x       = std::max(tx * tile_size_, ri.min_x);
+          tile_ri.min_y       = std::max(ty * tile_size_, ri.min_y);
+          tile_ri.max_x = std::min((tx + 1) * tile_size_ - 1, ri.max_x);
+          tile_ri.max_y = std::min((ty + 1) * tile_size_ - 1, ri.max_y);
+          if(tile_shading_rate_) {
+            tile_ri.shading_block =
+                shading_block_size(tile_shading_rate_(tx, ty));
+          }
+          draw(tile_ri, tile_bins_[tile], worker_stats[worker]);
+        });
+
+    for(auto const& ws : worker_stats) {
+      stats += ws;
+    }
+  }
+
+  // A projected line. Points are lines whose ends are the same vertex.
+  template <typename VertexOutput>
+  using segment = std::array<VertexOutput, 2>;
+
+  // Line and point lists. Vertices are shaded and clipped on the calling
+  // thread, and in tiled mode the lines are binned and stepped by the
+  // workers like triangles.
+  pipeline_counters draw_lines_and_points() const {
+    using vertex_type  = decltype(derived().shade_vertex(0, 0));
+    using segment_type = segment<vertex_type>;
+
+    pipeline_counters stats;
+    stats.increment_draw_count();
+    raster_info const ri = full_target_raster_info();
+    bool const points    = topology_ == primitive_topology::point_list;
+    model const& model   = *model_;
+    std::vector<segment_type> segments;
+    segments.reserve(model.nfaces() * 3);
+    auto cache = make_vertex_cache<vertex_type>(stats);
+    {
+      SWGL_TRACE_SCOPE("geometry", "stage");
+      for(int iface = 0; iface < model.nfaces(); ++iface) {
+        face<vertex_type> vertex_out;
+        shade_face(iface, vertex_out, cache, stats);
+        stage_timer const timer(stats, pipeline_stage::setup);
+        for(int j = 0; j < 3; ++j) {
+          vertex_type const& end = vertex_out[points ? j : (j + 1) % 3];
+          clip_segment(ri, vertex_out[j], end, [&](segment_type const& line) {
+            if(points) {
+              stats.increment_point_count();
+            }
+            else {
+              stats.increment_line_count();
+            }
+            segments.push_back(line);
+          });
+        }
+      }
+    }
+
+    if(!pool_) {
+      SWGL_TRACE_SCOPE("rasterisation", "stage");
+      for(auto const& line : segments) {
+        draw_segment(ri, line, stats);
+      }
+      return stats;
+    }
+
+    draw_binned(
+        *pool_, ri, segments.size(),
+        [&](std::size_t i, vector2i& pmin, vector2i& pmax) {
+          auto const& line  = segments[i];
+          vector2i const p0 = line_pixel(screen_position(line[0].position));
+          vector2i const p1 = line_pixel(screen_position(line[1].position));
+          pmin = vector2i(std::min(p0.x, p1.x), std::min(p0.y, p1.y));
+          pmax = vector2i(std::max(p0.x, p1.x), std::max(p0.y, p1.y));
+          return true;
+        },
+        [&](raster_info const& tile_ri, std::vector<int> const& bin,
+            pipeline_counters& tile_stats) {
+          for(int idx : bin) {
+            draw_segment(tile_ri, segments[idx], tile_stats);
+          }
+        },
+        stats);
+    return stats;
+  }
+
+  static vector4f homogeneous(vector3f const& p) {
+    return vector_widen<4>(p, 1.f);
+  }
+
+  static vector4f const& homogeneous(vector4f const& p) {
+    return p;
+  }
+
+  template <typename VertexOutput>
+  static void project(VertexOutput& v, std::true_type) {
+    project(v);
+  }
+
+  template <typename VertexOutput>
+  static void project(VertexOutput&, std::false_type) {
+  }
+
+  // Clips the line from a to b to the near plane and to the guard band, and
+  // calls emit with what is left after projection. Lines entirely to one
+  // side of the draw rect, with a pixel to spare for where the ends round
+  // to, are rejected, but the guard band does not depend on the rect, so a
+  // line steps through the same pixels whatever scissor it is drawn with.
+  template <typename VertexOutput, typename EmitFn>
+  void clip_segment(
+      raster_info const& ri,
+      VertexOutput a,
+      VertexOutput b,
+      EmitFn const& emit) const {
+    if(ri.viewport_x != 0 || ri.viewport_y != 0) {
+      move_to_viewport(ri, a.position);
+      move_to_viewport(ri, b.position);
+    }
+
+    clip_volume const target(
+        ri.min_x - 1.f, ri.min_y - 1.f, ri.max_x + 2.f, ri.max_y + 2.f, 0.f);
+    if(target.outcode(homogeneous(a.position)) &
+       target.outcode(homogeneous(b.position))) {
+      return;
+    }
+
+    clip_volume const guard_band(
+        0.f, 0.f, ri.width, ri.height, clip_guard_band);
+    float t0 = 0.f;
+    float t1 = 1.f;
+    for(int plane = 0; plane < clip_volume::plane_count; ++plane) {
+      float const da = guard_band.distance(plane, homogeneous(a.position));
+      float const db = guard_band.distance(plane, homogeneous(b.position));
+      if(da < 0.f && db < 0.f) {
+        return;
+      }
+      if(da < 0.f) {
+        t0 = std::max(t0, da / (da - db));
+      }
+      else if(db < 0.f) {
+        t1 = std::min(t1, da / (da - db));
+      }
+    }
+
+    if(t0 > t1) {
+      return;
+    }
+
+    segment<VertexOutput> line = {{a, b}};
+    if(t0 > 0.f) {
+      line[0] = a * (1.f - t0) + b * t0;
+    }
+    if(t1 < 1.f) {
+      line[1] = a * (1.f - t1) + b * t1;
+    }
+    for(auto& v : line) {
+      project(v, homogeneous_position<VertexOutput>());
+    }
+    emit(line);
+  }
+
+  // The pixel whose sample point is nearest p. The float rasteriser samples
+  // pixels at their top left corner and the fixed point one at their centre.
+  vector2i line_pixel(vector3f const& p) const {
+    float const offset =
+        raster_mode_ == raster_mode::fixed_point ? 0.f : 0.5f;
+    return vector2i(
+        static_cast<int>(std::floor(p.x + offset)),
+        static_cast<int>(std::floor(p.y + offset)));
+  }
+
+  template <typename VertexOutput>
+  void draw_segment(
+      raster_info const& ri,
+      segment<VertexOutput> const& line,
+      pipeline_counters& stats) const {
+    stage_timer const timer(stats, pipeline_stage::rasterisation);
+    with_depth_encoding(ri, [&](auto const& encoding) {
+      this->rasterise_segment(ri, encoding, line, stats);
+    });
+  }
+
+  // Integer DDA along the major axis of the line. The minor axis offset at
+  // step i is i * minor / major rounded to nearest; it is evaluated directly
+  // at the first step inside ri and then stepped Bresenham style, so a tile
+  // that picks a line up partway along gets the same pixels as the serial
+  // path.
+  template <typename Encoding, typename VertexOutput>
+  void rasterise_segment(
+      raster_info const& ri,
+      Encoding const& encoding,
+      segment<VertexOutput> const& line,
+      pipeline_counters& stats) const {
+    vector3f const a  = screen_position(line[0].position);
+    vector3f const b  = screen_position(line[1].position);
+    vector2i const p0 = line_pixel(a);
+    vector2i const p1 = line_pixel(b);
+    if(ri.resolve_clears) {
+      resolve_clears(
+          ri, vector2i(std::min(p0.x, p1.x), std::min(p0.y, p1.y)),
+          vector2i(std::max(p0.x, p1.x), std::max(p0.y, p1.y)), stats);
+    }
+
+    // Work in (major, minor) coordinates, swapping x and y for steep lines.
+    bool const steep = std::abs(p1.y - p0.y) > std::abs(p1.x - p0.x);
+    auto const swap  = [steep](vector2i v) {
+      return steep ? vector2i(v.y, v.x) : v;
+    };
+
+    vector2i const from = swap(p0);
+    vector2i const to   = swap(p1);
+    vector2i const lo   = swap(vector2i(ri.min_x, ri.min_y));
+    vector2i const hi   = swap(vector2i(ri.max_x, ri.max_y));
+    int const major     = std::abs(to.x - from.x);
+    int const minor     = std::abs(to.y - from.y);
+    int const major_dir = to.x < from.x ? -1 : 1;
+    int const minor_dir = to.y < from.y ? -1 : 1;
+
+    int const first =
+        std::max(major_dir > 0 ? lo.x - from.x : from.x - hi.x, 0);
+    int const last =
+        std::min(major_dir > 0 ? hi.x - from.x : from.x - lo.x, major);
+    if(first > last) {
+      return;
+    }
+
+    int const two_major = 2 * major;
+    int m               = from.y;
+    int error           = 0;
+    if(major > 0) {
+      std::int64_t const num =
+          2 * static_cast<std::int64_t>(first) * minor + major;
+      m += minor_dir * static_cast<int>(num / two_major);
+      error = static_cast<int>(num % two_major);
+    }
+
+    float const step = major > 0 ? 1.f / major : 0.f;
+    for(int i = first; i <= last; ++i) {
+      if(m >= lo.y && m <= hi.y) {
+        vector2i const P = swap(vector2i(from.x + major_dir * i, m));
+        float const t    = i * step;
+        draw_segment_pixel(
+            ri, encoding, P, a.z + (b.z - a.z) * t, line, t, stats);
+      }
+
+      error += 2 * minor;
+      if(error >= two_major) {
+        error -= two_major;
+        m += minor_dir;
+      }
+    }
+  }
+
+  // Depth tests every sample of pixel P against z and shades the pixel once
+  // if any pass, with the line's outputs at t along it.
+  template <typename Encoding, typename VertexOutput>
+  void draw_segment_pixel(
+      raster_info const& ri,
+      Encoding const& encoding,
+      vector2i P,
+      float z,
+      segment<VertexOutput> const& line,
+      float t,
+      pipeline_counters& stats) const {
+    auto const stored        = encoding.encode(z);
+    auto* const depth        = depth_at<Encoding>(ri, P.x, P.y);
+    sample_coverage coverage = {(1u << ri.samples) - 1, 0u};
+    bool cleared             = true;
+    for(int s = 0; s < ri.samples; ++s) {
+      cleared &= depth[s] == Encoding::cleared;
+      if(stored > depth[s]) {
+        depth[s] = stored;
+        coverage.passed |= 1u << s;
+      }
+    }
+    if(!coverage.passed) {
+      return;
+    }
+
+    if(cleared) {
+      stats.increment_unique_pixel_count();
+    }
+    stats.increment_pixel_count();
+    shade_pixel(P, segment_vertex(line, t), coverage, stats);
+  }
+
+  // Vertex outputs at t along a projected line, perspective correct when
+  // set_perspective_correction is on.
+  template <typename VertexOutput>
+  VertexOutput segment_vertex(
+      segment<VertexOutput> const& line, float t) const {
+    if(t == 0.f) {
+      return line[0];
+    }
+
+    float wa = 1.f - t;
+    float wb = t;
+    if(perspective_correction_) {
+      wa *= inverse_w(line[0].position);
+      wb *= inverse_w(line[1].position);
+      float const norm = 1.f / (wa + wb);
+      wa *= norm;
+      wb *= norm;
+    }
+    return line[0] * wa + line[1] * wb;
+  }
+
+  // Screen bbox of the pixels a triangle may cover, grown by the sample
+  // pattern when multisampling.
+  template <typename VertexOutput>
+  static swgl::bbox<float, 3> screen_bbox(
+      raster_info const& ri, VertexOutput const& tri) {
+    swgl::bbox<float, 3> box(screen_position(tri[0].position));
+    box.expand(screen_position(tri[1].position));
+    box.expand(screen_position(tri[2].position));
+    if(ri.samples > 1) {
+      vector3f const r(
+          multisample_target::sample_radius, multisample_target::sample_radius,
+          0.f);
+      box = swgl::bbox<float, 3>(box.min() - r, box.max() + r);
+    }
+    box.clamp({0.f, 0.f, 0.f}, vector3f(ri.width - 1.f, ri.height - 1.f, 0.f));
+    return box;
+  }
+
+  template <typename VertexOutput>
+  void draw_triangle(
+      raster_info const& ri,
+      VertexOutput const& tri,
+      pipeline_counters& stats) const {
+    stage_timer const timer(stats, pipeline_stage::rasterisation);
+    auto const planes = setup_attributes(tri, stats);
+    if(ri.shading_block > 1) {
+      coarse_cache<64> cache;
+      rasterise(
+          ri, tri, stats, [&](vector2i P, sample_coverage const& coverage) {
+            auto& block = cache.find(ri, P, 0);
+            if(!block.shaded) {
+              block.kept = shade(
+                  planes.at_clamped(block_centre(ri, P)), block.colour, stats);
+              block.shaded = true;
+            }
+            if(block.kept) {
+              write_pixel(P, block.colour, coverage, stats);
+            }
+          });
+      return;
+    }
+
+    rasterise(
+        ri, tri, stats,
+        [this, &ri, &stats, planes](
+            vector2i P, sample_coverage const& coverage) {
+          shade_pixel(
+              P, planes.at(P, shading_offset(ri, coverage)), coverage, stats);
+        });
+  }
+
+  static int shading_block_size(shading_rate rate) {
+    switch(rate) {
+      case shading_rate::coarse_2x2: return 2;
+      case shading_rate::coarse_4x4: return 4;
+      default: return 1;
+    }
+  }
+
+  // Centre of the shading block that holds P.
+  static vector2f block_centre(raster_info const& ri, vector2i P) {
+    int const n      = ri.shading_block;
+    float const half = (n - 1) * 0.5f;
+    return vector2f(P.x / n * n + half, P.y / n * n + half);
+  }
+
+  // Colours shaded at a coarse rate, looked up by block and triangle. It is
+  // direct mapped, so a collision only costs another shader call; the
+  // colour of a block only depends on where it is.
+  template <int Size>
+  class coarse_cache {
+   public:
+    struct entry {
+      int block_x;
+      int block_y;
+      int triangle;
+      bool shaded = false;
+      bool kept;
+      image::colour_type colour;
+    };
+
+    entry& find(raster_info const& ri, vector2i P, int triangle) {
+      int const bx = P.x / ri.shading_block;
+      int const by = P.y / ri.shading_block;
+      entry& e     = entries_[(bx ^ (triangle << 3)) & (Size - 1)];
+      if(!e.shaded || e.block_x != bx || e.block_y != by ||
+         e.triangle != triangle) {
+        e.block_x  = bx;
+        e.block_y  = by;
+        e.triangle = triangle;
+        e.shaded   = false;
+      }
+      return e;
+    }
+
+   private:
+    entry entries_[Size];
+  };
+
+  // Attribute setup for a projected triangle. The planes are sampled where
+  // the rasteriser that draws the triangle samples, and based at a pixel on
+  // the render target so the values that are used stay accurate. A pixel's
+  // value only depends on its position, so tiles match the serial path.
+  template <typename T>
+  attribute_planes<T> setup_attributes(
+      face<T> const& tri, pipeline_counters& stats) const {
+    stage_timer const timer(stats, pipeline_stage::setup);
+    vector3f const a = screen_position(tri[0].position);
+    vector3f const b = screen_position(tri[1].position);
+    vector3f const c = screen_position(tri[2].position);
+
+    attribute_planes<T> planes;
+    planes.base = vector2i(
+        static_cast<int>(std::min(std::max(a.x, 0.f), target_width() - 1.f)),
+        static_cast<int>(
+            std::min(std::max(a.y, 0.f), target_height() - 1.f)));
+    planes.perspective =
+        perspective_correction_ && homogeneous_position<T>::value;
+
+    barycentric_basis const basis(a, b, c);
+    float const area_recip = 1.f / basis.area();
+    float const sample     = uses_fixed_point(a, b, c) ? 0.5f : 0.f;
+    vector3f const bc_dx   = basis.step_x() * area_recip;
+    vector3f const bc_dy   = basis.step_y() * area_recip;
+    vector3f const bc_base = basis.edges(planes.base) * area_recip +
+                             (bc_dx + bc_dy) * sample;
+
+    vector3f q(1.f, 1.f, 1.f);
+    if(planes.perspective) {
+      q = vector3f(
+          inverse_w(tri[0].position), inverse_w(tri[1].position),
+          inverse_w(tri[2].position));
+    }
+
+    constexpr std::size_t count = attribute_planes<T>::count;
+    float v[3][count];
+    for(int j = 0; j < 3; ++j) {
+      store_attributes(tri[j], v[j]);
+    }
+
+    auto const blend = [&v, &q](vector3f const& w, float* out) {
+      vector3f const wq(w.x * q.x, w.y * q.y, w.z * q.z);
+      for(std::size_t i = 0; i < count; ++i) {
+        out[i] = v[0][i] * wq.x + v[1][i] * wq.y + v[2][i] * wq.z;
+      }
+    };
+    blend(bc_base, planes.at_base);
+    blend(bc_dx, planes.dx);
+    blend(bc_dy, planes.dy);
+    planes.inv_w   = vector3f(dot(q, bc_base), dot(q, bc_dx), dot(q, bc_dy));
+    planes.bc_base = bc_base;
+    planes.bc_dx   = bc_dx;
+    planes.bc_dy   = bc_dy;
+
+    vector3f const* const vertices[] = {&a, &b, &c};
+    for(int j = 0; j < 3; ++j) {
+      planes.corner[j] = vector2f(
+          vertices[j]->x - planes.base.x - sample,
+          vertices[j]->y - planes.base.y - sample);
+    }
+    return planes;
+  }
+
+  // Walks the fragments of a triangle, depth tests them and calls
+  // fragment(P, coverage) for the ones that pass, after updating the depth
+  // buffer.
+  template <typename VertexOutput, typename FragmentFn>
+  void rasterise(
+      raster_info const& ri,
+      VertexOutput const& tri,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) const {
+    if(ri.samples > 1) {
+      rasterise_multisample(ri, tri, stats, fragment);
+      return;
+    }
+
+    if(ri.resolve_clears) {
+      resolve_clears(ri, tri, stats);
+    }
+
+    bool const fixed = uses_fixed_point(
+        screen_position(tri[0].position), screen_position(tri[1].position),
+        screen_position(tri[2].position));
+    with_depth_encoding(ri, [&](auto const& encoding) {
+      if(fixed) {
+        this->rasterise_fixed(ri, encoding, tri, stats, fragment);
+      }
+      else {
+        this->rasterise_float(ri, encoding, tri, stats, fragment);
+      }
+    });
+  }
+
+  // Writes pending fast clears into the tiles of the render target and depth
+  // buffer that a triangle may touch, with a pixel of slack for the fixed
+  // point rasteriser's rounding.
+  template <typename VertexOutput>
+  void resolve_clears(
+      raster_info const& ri,
+      VertexOutput const& tri,
+      pipeline_counters& stats) const {
+    auto const box  = screen_bbox(ri, tri);
+    auto const bmin = box.min();
+    auto const bmax = box.max();
+    if(!(bmin.x <= bmax.x && bmin.y <= bmax.y)) {
+      return;
+    }
+
+    vector2i const pmin(static_cast<int>(bmin.x), static_cast<int>(bmin.y));
+    vector2i const pmax(static_cast<int>(bmax.x), static_cast<int>(bmax.y));
+    resolve_clears(
+        ri, pmin - vector2i(1, 1), pmax + vector2i(1, 1), stats);
+  }
+
+  // Resolves the fast clears of the inclusive pixel rect [pmin, pmax],
+  // clipped to ri.
+  void resolve_clears(
+      raster_info const& ri,
+      vector2i const& pmin,
+      vector2i const& pmax,
+      pipeline_counters& stats) const {
+    int const min_x = std::max(pmin.x, ri.min_x);
+    int const min_y = std::max(pmin.y, ri.min_y);
+    int const max_x = std::min(pmax.x, ri.max_x);
+    int const max_y = std::min(pmax.y, ri.max_y);
+    if(min_x > max_x || min_y > max_y) {
+      return;
+    }
+
+    stage_timer const timer(stats, pipeline_stage::output);
+    rt_->resolve_clear(min_x, min_y, max_x, max_y);
+    depth_->resolve_clear(min_x, min_y, max_x, max_y);
+  }
+
+  // Floating point path. Depth is interpolated as a float and converted to
+  // the depth buffer's format with encoding before it is tested.
+  template <typename Encoding, typename VertexOutput, typename FragmentFn>
+  void rasterise_float(
+      raster_info const& ri,
+      Encoding const& encoding,
+      VertexOutput const& tri,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) const {
+    auto box     = screen_bbox(ri, tri);
+    auto bboxmin = box.min();
+    auto bboxmax = box.max();
+    if(!(bboxmin.x <= bboxmax.x && bboxmin.y <= bboxmax.y)) {
+      return;
+    }
+
+    int const min_x = std::max(static_cast<int>(bboxmin.x), ri.min_x);
+    int const min_y = std::max(static_cast<int>(bboxmin.y), ri.min_y);
+    int const max_x = std::min(static_cast<int>(bboxmax.x), ri.max_x);
+    int const max_y = std::min(static_cast<int>(bboxmax.y), ri.max_y);
+
+    barycentric_basis barycentric(
+        screen_position(tri[0].position), screen_position(tri[1].position),
+        screen_position(tri[2].position));
+    if(barycentric.degenerate()) {
+      return;
+    }
+
+    // Triangle setup: normalised barycentric and depth steps, so the inner
+    // loop is a handful of adds per pixel.
+    float const area_recip = barycentric.area_recip();
+    vector3f const z(tri[0].position.z, tri[1].position.z, tri[2].position.z);
+    vector3f const bc_dx = barycentric.step_x() * area_recip;
+    float const z_dx     = dot(z, bc_dx);
+
+    // The depth plane is linear, so its nearest point in a rect is at one of
+    // the corners. It's also never nearer than the nearest vertex.
+    float const z_max = std::max({z.x, z.y, z.z});
+    float const z_magnitude =
+        std::max({std::abs(z.x), std::abs(z.y), std::abs(z.z)});
+    auto const nearest = [&](int x0, int y0, int x1, int y1) {
+      float const z00       = dot(z, barycentric.edges(vector2i(x0, y0)));
+      float const z_dx_rect = dot(z, barycentric.step_x()) * (x1 - x0);
+      float const z_dy_rect = dot(z, barycentric.step_y()) * (y1 - y0);
+      float const corner =
+          (z00 + std::max(z_dx_rect, 0.f) + std::max(z_dy_rect, 0.f)) *
+          area_recip;
+      float const corner_other =
+          (z00 + std::min(z_dx_rect, 0.f) + std::min(z_dy_rect, 0.f)) *
+          area_recip;
+      return static_cast<float>(encoding.encode(conservative_nearest(
+          std::min(std::max(corner, corner_other), z_max), z_magnitude)));
+    };
+
+    // Each row is walked in spans anchored at multiples of span_width, and the
+    // anchors are evaluated directly. The value at a pixel then only depends
+    // on its position, not on where the bbox was clipped, so tiles match the
+    // serial path exactly.
+    span_steps const steps(bc_dx, z_dx);
+    auto const draw_block = [&](int x0, int y0, int x1, int y1) {
+      bool wrote = false;
+      for(int y = y0; y <= y1; y++) {
+        for(int span_x = x0 & ~(span_width - 1); span_x <= x1;
+            span_x += span_width) {
+          vector3f const bc_anchor =
+              barycentric.edges(vector2i(span_x, y)) * area_recip;
+          wrote |= rasterise_span(
+              ri, encoding, vector2i(span_x, y), std::max(x0 - span_x, 0),
+              std::min(x1 - span_x, span_width - 1), bc_anchor,
+              dot(z, bc_anchor), steps, stats, fragment);
+        }
+      }
+      return wrote;
+    };
+
+    visit_blocks(ri, min_x, min_y, max_x, max_y, nearest, draw_block, stats);
+  }
+
+  // Exact integer path. The edges are stepped with integer adds, so the
+  // result is independent of the starting pixel and tiles need no anchoring.
+  template <typename Encoding, typename VertexOutput, typename FragmentFn>
+  void rasterise_fixed(
+      raster_info const& ri,
+      Encoding const& encoding,
+      VertexOutput const& tri,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) const {
+    fixed_barycentric_basis barycentric(
+        screen_position(tri[0].position), screen_position(tri[1].position),
+        screen_position(tri[2].position));
+    if(barycentric.degenerate()) {
+      return;
+    }
+
+    vector2i const pmin = barycentric.min_pixel();
+    vector2i const pmax = barycentric.max_pixel();
+    int const min_x     = std::max(pmin.x, ri.min_x);
+    int const min_y     = std::max(pmin.y, ri.min_y);
+    int const max_x     = std::min(pmax.x, ri.max_x);
+    int const max_y     = std::min(pmax.y, ri.max_y);
+
+    vector3f const z(tri[0].position.z, tri[1].position.z, tri[2].position.z);
+    float const z_nearest = static_cast<float>(
+        encoding.encode(conservative_nearest(
+            std::max({z.x, z.y, z.z}),
+            std::max({std::abs(z.x), std::abs(z.y), std::abs(z.z)}))));
+    auto const nearest = [z_nearest](int, int, int, int) { return z_nearest; };
+
+    auto const& step_x    = barycentric.step_x();
+    auto const draw_block = [&](int x0, int y0, int x1, int y1) {
+      bool wrote = false;
+      for(int y = y0; y <= y1; y++) {
+        auto* const depth_row = depth_at<Encoding>(ri, 0, y);
+        auto e                = barycentric.edges(vector2i(x0, y));
+        stats.add_tested_pixel_count(x1 - x0 + 1);
+        for(int x = x0; x <= x1; x++, e += step_x) {
+          if(!fixed_barycentric_basis::covered(e))
+            continue;
+          stats.add_covered_pixel_count(1);
+          auto const Z = encoding.encode(dot(z, barycentric.weights(e)));
+          if(Z > depth_row[x]) {
+            accept_fragment(vector2i(x, y), Z, depth_row[x], stats, fragment);
+            wrote = true;
+          }
+        }
+      }
+      return wrote;
+    };
+
+    visit_blocks(ri, min_x, min_y, max_x, max_y, nearest, draw_block, stats);
+  }
+
+  // Multisampled twin of rasterise. Coverage and depth are evaluated at
+  // every sample, relative to the pixel's own sample point so the result
+  // only depends on the pixel's position, and fragment is called once for
+  // each pixel where any sample passed.
+  template <typename VertexOutput, typename FragmentFn>
+  void rasterise_multisample(
+      raster_info const& ri,
+      VertexOutput const& tri,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) const {
+    constexpr int samples = multisample_target::sample_count;
+    vector3f const a      = screen_position(tri[0].position);
+    vector3f const b      = screen_position(tri[1].position);
+    vector3f const c      = screen_position(tri[2].position);
+    vector3f const z(a.z, b.z, c.z);
+    float const z_nearest = conservative_nearest(
+        std::max({z.x, z.y, z.z}),
+        std::max({std::abs(z.x), std::abs(z.y), std::abs(z.z)}));
+    auto const nearest = [z_nearest](int, int, int, int) { return z_nearest; };
+
+    // Depth tests the samples of pixel (x, y), given a function that returns
+    // whether sample s is covered and sets its depth, and calls fragment if
+    // any passed.
+    auto const shade_samples = [&](int x, int y, auto const& sample) {
+      float* const depth       = depth_at<float32_depth>(ri, x, y);
+      sample_coverage coverage = {0, 0};
+      bool cleared             = true;
+      for(int s = 0; s < samples; ++s) {
+        cleared &= depth[s] == float32_depth::cleared;
+        float Z;
+        if(sample(s, Z)) {
+          coverage.covered |= 1u << s;
+          if(Z > depth[s]) {
+            depth[s] = Z;
+            coverage.passed |= 1u << s;
+          }
+        }
+      }
+
+      stats.add_tested_pixel_count(1);
+      if(coverage.covered) {
+        stats.add_covered_pixel_count(1);
+      }
+      if(!coverage.passed) {
+        return false;
+      }
+
+      if(cleared) {
+        stats.increment_unique_pixel_count();
+      }
+      stats.increment_pixel_count();
+      fragment(vector2i(x, y), coverage);
+      return true;
+    };
+
+    if(uses_fixed_point(a, b, c)) {
+      fixed_barycentric_basis const barycentric(a, b, c);
+      if(barycentric.degenerate()) {
+        return;
+      }
+
+      fixed_barycentric_basis::edge_type offsets[samples];
+      for(int s = 0; s < samples; ++s) {
+        offsets[s] = fixed_sample_offset(ri, barycentric, s);
+      }
+
+      vector2i const pmin = barycentric.min_pixel();
+      vector2i const pmax = barycentric.max_pixel();
+      auto const draw_block = [&](int x0, int y0, int x1, int y1) {
+        bool wrote = false;
+        for(int y = y0; y <= y1; y++) {
+          for(int x = x0; x <= x1; x++) {
+            auto const e = barycentric.edges(vector2i(x, y));
+            wrote |= shade_samples(x, y, [&](int s, float& Z) {
+              auto const es = e + offsets[s];
+              if(!fixed_barycentric_basis::covered(es)) {
+                return false;
+              }
+              Z = dot(z, barycentric.weights(es));
+              return true;
+            });
+          }
+        }
+        return wrote;
+      };
+
+      visit_blocks(
+          ri, std::max(pmin.x - 1, ri.min_x), std::max(pmin.y - 1, ri.min_y),
+          std::min(pmax.x + 1, ri.max_x), std::min(pmax.y + 1, ri.max_y),
+          nearest, draw_block, stats);
+      return;
+    }
+
+    auto box     = screen_bbox(ri, tri);
+    auto bboxmin = box.min();
+    auto bboxmax = box.max();
+    if(!(bboxmin.x <= bboxmax.x && bboxmin.y <= bboxmax.y)) {
+      return;
+    }
+
+    barycentric_basis const barycentric(a, b, c);
+    if(barycentric.degenerate()) {
+      return;
+    }
+
+    // Normalised weights and depth of each sample relative to the pixel.
+    float const area_recip = barycentric.area_recip();
+    float const scale      = 1.f / multisample_target::sample_offset_scale;
+    vector3f offsets[samples];
+    float z_offsets[samples];
+    for(int s = 0; s < samples; ++s) {
+      vector2i const o  = multisample_target::sample_offset(s);
+      vector3f const dx = barycentric.step_x() * (o.x * scale);
+      vector3f const dy = barycentric.step_y() * (o.y * scale);
+      offsets[s]        = (dx + dy) * area_recip;
+      z_offsets[s]      = dot(z, offsets[s]);
+    }
+
+    auto const draw_block = [&](int x0, int y0, int x1, int y1) {
+      bool wrote = false;
+      for(int y = y0; y <= y1; y++) {
+        for(int x = x0; x <= x1; x++) {
+          vector3f const bc = barycentric.edges(vector2i(x, y)) * area_recip;
+          float const Z     = dot(z, bc);
+          wrote |= shade_samples(x, y, [&](int s, float& Zs) {
+            vector3f const bs = bc + offsets[s];
+            Zs                = Z + z_offsets[s];
+            return bs.x >= 0.f && bs.y >= 0.f && bs.z >= 0.f;
+          });
+        }
+      }
+      return wrote;
+    };
+
+    visit_blocks(
+        ri, std::max(static_cast<int>(bboxmin.x), ri.min_x),
+        std::max(static_cast<int>(bboxmin.y), ri.min_y),
+        std::min(static_cast<int>(bboxmax.x), ri.max_x),
+        std::min(static_cast<int>(bboxmax.y), ri.max_y), nearest, draw_block,
+        stats);
+  }
+
+#if SWGL_SIMD_AVX2 || SWGL_SIMD_SSE2
+  static constexpr int span_width = simd::float_v::width;
+
+  // Per-lane offsets from a span anchor, computed once per triangle.
+  struct span_steps {
+    span_steps(vector3f const& bc_dx, float z_dx)
+        : bc0(simd::float_v::ramp() * simd::float_v(bc_dx.x))
+        , bc1(simd::float_v::ramp() * simd::float_v(bc_dx.y))
+        , bc2(simd::float_v::ramp() * simd::float_v(bc_dx.z))
+        , z(simd::float_v::ramp() * simd::float_v(z_dx)) {
+    }
+
+    simd::float_v bc0;
+    simd::float_v bc1;
+    simd::float_v bc2;
+    simd::float_v z;
+  };
+
+  // Tests coverage and depth for a whole span at once and only hands the
+  // surviving lanes to the fragment shader. Lanes outside [first, last] are
+  // ignored.
+  template <typename Encoding, typename FragmentFn>
+  bool rasterise_span(
+      raster_info const& ri,
+      Encoding const& encoding,
+      vector2i span,
+      int first,
+      int last,
+      vector3f const& bc_anchor,
+      float z_anchor,
+      span_steps const& steps,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) const {
+    using simd::float_v;
+    float_v const zero(0.f);
+    float_v const b0 = float_v(bc_anchor.x) + steps.bc0;
+    float_v const b1 = float_v(bc_anchor.y) + steps.bc1;
+    float_v const b2 = float_v(bc_anchor.z) + steps.bc2;
+    int const lanes  = ((2 << last) - 1) & ~((1 << first) - 1);
+    int covered = ((b0 >= zero) & (b1 >= zero) & (b2 >= zero)).bits() & lanes;
+    stats.add_tested_pixel_count(last - first + 1);
+    stats.add_covered_pixel_count(
+        static_cast<int>(std::bitset<span_width>(covered).count()));
+    if(!covered) {
+      return false;
+    }
+
+    // Spans at the sides of ri can hang off the end of the buffer or over
+    // pixels another pipeline is drawing, so only the lanes inside ri are
+    // read there. Integer depth is compared as floats, which hold it exactly.
+    using value_type = typename Encoding::value_type;
+    value_type* const depth_row        = depth_at<Encoding>(ri, span.x, span.y);
+    value_type depth_lanes[span_width] = {};
+    float_v depth_v(0.f);
+    if(span.x >= ri.min_x && span.x + span_width <= ri.max_x + 1) {
+      depth_v = float_v::load(depth_row);
+    }
+    else {
+      int const lo = std::max(ri.min_x - span.x, 0);
+      int const hi = std::min(ri.max_x + 1 - span.x, int(span_width));
+      std::copy(depth_row + lo, depth_row + hi, depth_lanes + lo);
+      depth_v = float_v::load(depth_lanes);
+    }
+
+    float_v const z = encoding.encode(float_v(z_anchor) + steps.z);
+    int const alive = covered & (z > depth_v).bits();
+    if(!alive) {
+      return false;
+    }
+
+    float z_lanes[span_width];
+    z.store(z_lanes);
+    for(int lane = first; lane <= last; ++lane) {
+      if(alive & (1 << lane)) {
+        accept_fragment(
+            vector2i(span.x + lane, span.y),
+            static_cast<value_type>(z_lanes[lane]), depth_row[lane], stats,
+            fragment);
+      }
+    }
+    return true;
+  }
+#else
+  static constexpr int span_width = 8;
+
+  struct span_steps {
+    span_steps(vector3f const& bc_dx, float z_dx)
+        : bc(bc_dx)
+        , z(z_dx) {
+    }
+
+    vector3f bc;
+    float z;
+  };
+
+  template <typename Encoding, typename FragmentFn>
+  bool rasterise_span(
+      raster_info const& ri,
+      Encoding const& encoding,
+      vector2i span,
+      int first,
+      int last,
+      vector3f bc_screen,
+      float Z,
+      span_steps const& steps,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) const {
+    auto* const depth_row = depth_at<Encoding>(ri, span.x, span.y);
+    bool wrote            = false;
+    for(int lane = 0; lane <= last;
+        lane++, bc_screen += steps.bc, Z += steps.z) {
+      if(lane < first)
+        continue;
+      stats.add_tested_pixel_count(1);
+      if(bc_screen.x < 0 || bc_screen.y < 0 || bc_screen.z < 0)
+        continue;
+      stats.add_covered_pixel_count(1);
+      auto const stored = encoding.encode(Z);
+      if(stored > depth_row[lane]) {
+        accept_fragment(
+            vector2i(span.x + lane, span.y), stored, depth_row[lane], stats,
+            fragment);
+        wrote = true;
+      }
+    }
+    return wrote;
+  }
+#endif
+
+  // Called for a fragment that has passed the depth test, with its depth
+  // encoded like the depth buffer.
+  template <typename T, typename FragmentFn>
+  static void accept_fragment(
+      vector2i P,
+      T Z,
+      T& depth,
+      pipeline_counters& stats,
+      FragmentFn const& fragment) {
+    // Every depth format clears to the lowest value of its type.
+    if(depth == std::numeric_limits<T>::lowest()) {
+      stats.increment_unique_pixel_count();
+    }
+    depth = Z;
+    stats.increment_pixel_count();
+    fragment(P, sample_coverage{1u, 1u});
+  }
+
+  // Where a fragment's attributes are evaluated, relative to the point the
+  // pixel is sampled at without multisampling. Partly covered pixels use the
+  // centroid of the samples the triangle covers, which is always inside it,
+  // so attributes such as texture coordinates are never extrapolated.
+  static vector2f shading_offset(
+      raster_info const& ri, sample_coverage const& coverage) {
+    unsigned const all = (1u << ri.samples) - 1;
+    if(coverage.covered == all) {
+      return vector2f::zero();
+    }
+
+    vector2i sum = vector2i::zero();
+    int count    = 0;
+    for(int s = 0; s < ri.samples; ++s) {
+      if(coverage.covered & (1u << s)) {
+        sum += multisample_target::sample_offset(s);
+        ++count;
+      }
+    }
+    float const scale =
+        1.f / (count * multisample_target::sample_offset_scale);
+    return vector2f(sum.x * scale, sum.y * scale);
+  }
+
+  // Runs the fragment shader, returning whether it kept the fragment.
+  template <typename VertexOutput>
+  bool shade(
+      VertexOutput const& in,
+      image::colour_type& out,
+      pipeline_counters& stats) const {
+    stage_timer const timer(stats, pipeline_stage::fragment_shading);
+    stats.increment_fragment_shader_count();
+    colour<float> lighted = derived().shade_fragment(in);
+    if(!(lighted.a() > 0.f)) {
+      return false;
+    }
+
+    out = colour_cast<std::uint8_t>(lighted);
+    return true;
+  }
+
+  void write_pixel(
+      vector2i P,
+      image::colour_type const& c,
+      sample_coverage const& coverage,
+      pipeline_counters& stats) const {
+    stage_timer const timer(stats, pipeline_stage::output);
+    if(msaa_) {
+      msaa_->set(P.x, P.y, coverage.passed, c);
+    }
+    else {
+      rt_->set(P.x, P.y, c);
+    }
+  }
+
+  template <typename VertexOutput>
+  void shade_pixel(
+      vector2i P,
+      VertexOutput const& in,
+      sample_coverage const& coverage,
+      pipeline_counters& stats) const {
+    image::colour_type c;
+    if(shade(in, c, stats)) {
+      write_pixel(P, c, coverage, stats);
+    }
   }
 
   Derived& derived() {
@@ -161,9 +2377,29 @@ class pipeline : public Base {
     return static_cast<Derived const&>(*this);
   }
 
-  model const* model_        = nullptr;
-  std::vector<float>* depth_ = nullptr;
-  image* rt_                 = nullptr;
+  model const* model_          = nullptr;
+  depth_buffer* depth_         = nullptr;
+  image* rt_                   = nullptr;
+  multisample_target* msaa_    = nullptr;
+  thread_pool* pool_           = nullptr;
+  int tile_size_               = 64;
+  raster_mode raster_mode_     = raster_mode::floating_point;
+  cull_mode cull_mode_         = cull_mode::back;
+  primitive_topology topology_ = primitive_topology::triangle_list;
+  bool hiz_enabled_            = false;
+  shading_mode shading_mode_   = shading_mode::forward;
+  bool perspective_correction_ = false;
+  shading_rate shading_rate_   = shading_rate::full;
+  screen_rect scissor_         = {};
+  bool scissor_enabled_        = false;
+  screen_rect viewport_        = {};
+  bool viewport_enabled_       = false;
+  std::function<shading_rate(int, int)> tile_shading_rate_;
+  mutable int hiz_blocks_x_    = 0;
+  mutable std::vector<float> hiz_farthest_;
+  mutable std::vector<char> hiz_stale_;
+  mutable std::vector<std::vector<int>> tile_bins_;
+  mutable std::vector<visibility_sample> visibility_;
 };
 
 } // namespace swgl
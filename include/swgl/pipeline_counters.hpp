@@ -19,11 +19,26 @@
 
 #include <algorithm>
 #include <array>
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#elif defined(__i386__) || defined(__x86_64__)
+#  include <x86intrin.h>
+#endif
 
 #ifndef SWGL_ENABLE_PIPELINE_COUNTERS
 #  define SWGL_ENABLE_PIPELINE_COUNTERS 1
 #endif
 
+// Per stage timing is off by default. Timers are read around every call to
+// the fragment shader, which costs far more than the counters, so turn it
+// on to find out where a frame's time goes rather than in a normal build.
+#ifndef SWGL_ENABLE_PIPELINE_TIMERS
+#  define SWGL_ENABLE_PIPELINE_TIMERS 0
+#endif
+
 #if SWGL_ENABLE_PIPELINE_COUNTERS
 #  define SWGL_PIPELINE_COUNTER(x)                                             \
     do {                                                                       \
@@ -37,6 +52,22 @@
 
 namespace swgl {
 
+// The stages a draw's time is split between.
+enum class pipeline_stage {
+  // shade_vertex calls, batched or not.
+  vertex_shading,
+  // Clipping, culling, triangle and attribute setup, and binning.
+  setup,
+  // Coverage, hierarchical depth and depth tests.
+  rasterisation,
+  // shade_fragment calls.
+  fragment_shading,
+  // Colour writes and fast clear resolves.
+  output,
+};
+
+static constexpr int pipeline_stage_count = 5;
+
 class pipeline_counters {
  public:
   pipeline_counters() = default;
@@ -45,41 +76,369 @@ class pipeline_counters {
     SWGL_PIPELINE_COUNTER(++num_pixels_);
   }
 
+  void increment_fragment_shader_count() {
+    SWGL_PIPELINE_COUNTER(++num_fragment_shaders_);
+  }
+
   void increment_triangle_count() {
     SWGL_PIPELINE_COUNTER(++num_triangles_);
   }
 
+  void increment_line_count() {
+    SWGL_PIPELINE_COUNTER(++num_lines_);
+  }
+
+  void increment_point_count() {
+    SWGL_PIPELINE_COUNTER(++num_points_);
+  }
+
   void increment_draw_count() {
     SWGL_PIPELINE_COUNTER(++num_draws_);
   }
 
-  int pixel_count() const {
+  void increment_culled_draw_count() {
+    SWGL_PIPELINE_COUNTER(++num_culled_draws_);
+  }
+
+  void increment_vertex_shader_count() {
+    SWGL_PIPELINE_COUNTER(++num_vertex_shaders_);
+  }
+
+  void add_vertex_shader_count(int count) {
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+    num_vertex_shaders_ += count;
+#else
+    (void)count;
+#endif
+  }
+
+  void increment_vertex_cache_hit_count() {
+    SWGL_PIPELINE_COUNTER(++num_vertex_cache_hits_);
+  }
+
+  void increment_frustum_culled_triangle_count() {
+    SWGL_PIPELINE_COUNTER(++num_frustum_culled_triangles_);
+  }
+
+  void increment_clipped_triangle_count() {
+    SWGL_PIPELINE_COUNTER(++num_clipped_triangles_);
+  }
+
+  void increment_degenerate_triangle_count() {
+    SWGL_PIPELINE_COUNTER(++num_degenerate_triangles_);
+  }
+
+  void increment_facing_culled_triangle_count() {
+    SWGL_PIPELINE_COUNTER(++num_facing_culled_triangles_);
+  }
+
+  void increment_missed_triangle_count() {
+    SWGL_PIPELINE_COUNTER(++num_missed_triangles_);
+  }
+
+  void increment_occluded_triangle_count() {
+    SWGL_PIPELINE_COUNTER(++num_occluded_triangles_);
+  }
+
+  void increment_occluded_block_count() {
+    SWGL_PIPELINE_COUNTER(++num_occluded_blocks_);
+  }
+
+  void increment_unique_pixel_count() {
+    SWGL_PIPELINE_COUNTER(++num_unique_pixels_);
+  }
+
+  void add_tested_pixel_count(int count) {
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+    num_tested_pixels_ += count;
+#else
+    (void)count;
+#endif
+  }
+
+  void add_covered_pixel_count(int count) {
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+    num_covered_pixels_ += count;
+#else
+    (void)count;
+#endif
+  }
+
+  void add_stage_time(
+      pipeline_stage stage, std::int64_t cycles, std::int64_t nanoseconds) {
+#if SWGL_ENABLE_PIPELINE_TIMERS
+    stage_cycles_[static_cast<int>(stage)] += cycles;
+    stage_nanoseconds_[static_cast<int>(stage)] += nanoseconds;
+    timed_cycles_ += cycles;
+    timed_nanoseconds_ += nanoseconds;
+#else
+    (void)stage;
+    (void)cycles;
+    (void)nanoseconds;
+#endif
+  }
+
+  // Pixels written, and calls to shade_fragment that produced them. At the
+  // full shading rate in forward mode the two match; coarse shading rates
+  // and the visibility buffer run the shader fewer times than that.
+  std::int64_t pixel_count() const {
     return SWGL_ENABLE_PIPELINE_COUNTERS ? num_pixels_ : 0;
   }
 
-  int triangle_count() const {
+  std::int64_t fragment_shader_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_fragment_shaders_ : 0;
+  }
+
+  std::int64_t triangle_count() const {
     return SWGL_ENABLE_PIPELINE_COUNTERS ? num_triangles_ : 0;
   }
 
-  int draw_count() const {
+  // Lines and points that were left after clipping, with the line_list and
+  // point_list topologies.
+  std::int64_t line_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_lines_ : 0;
+  }
+
+  std::int64_t point_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_points_ : 0;
+  }
+
+  std::int64_t draw_count() const {
     return SWGL_ENABLE_PIPELINE_COUNTERS ? num_draws_ : 0;
   }
 
+  // Draws skipped because the model's bounds were out of view.
+  std::int64_t culled_draw_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_culled_draws_ : 0;
+  }
+
+  // Calls to shade_vertex, and corners that were served from the vertex
+  // cache instead.
+  std::int64_t vertex_shader_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_vertex_shaders_ : 0;
+  }
+
+  std::int64_t vertex_cache_hit_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_vertex_cache_hits_ : 0;
+  }
+
+  float vertex_cache_hit_rate() const {
+    std::int64_t const lookups =
+        vertex_shader_count() + vertex_cache_hit_count();
+    return lookups ? vertex_cache_hit_count() / static_cast<float>(lookups)
+                   : 0.f;
+  }
+
+  // Triangles rejected for being entirely off screen or behind the near
+  // plane, and triangles that had to be clipped.
+  std::int64_t frustum_culled_triangle_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_frustum_culled_triangles_ : 0;
+  }
+
+  std::int64_t clipped_triangle_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_clipped_triangles_ : 0;
+  }
+
+  // Triangles discarded by primitive setup: ones with no area, ones culled
+  // by the cull mode, and ones that fall between pixel samples.
+  std::int64_t degenerate_triangle_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_degenerate_triangles_ : 0;
+  }
+
+  std::int64_t facing_culled_triangle_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_facing_culled_triangles_ : 0;
+  }
+
+  std::int64_t missed_triangle_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_missed_triangles_ : 0;
+  }
+
+  // Triangles and 8x8 blocks rejected by the hierarchical depth buffer. In
+  // tiled mode a triangle is counted once for each tile that rejects it.
+  std::int64_t occluded_triangle_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_occluded_triangles_ : 0;
+  }
+
+  std::int64_t occluded_block_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_occluded_blocks_ : 0;
+  }
+
+  // Pixels written that held the cleared depth before, which is the number
+  // of pixels covered if the depth buffer was cleared before the draws.
+  std::int64_t unique_pixel_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_unique_pixels_ : 0;
+  }
+
+  // Pixels the rasteriser tested for coverage, and the ones among them that
+  // a triangle covered.
+  std::int64_t tested_pixel_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_tested_pixels_ : 0;
+  }
+
+  std::int64_t covered_pixel_count() const {
+    return SWGL_ENABLE_PIPELINE_COUNTERS ? num_covered_pixels_ : 0;
+  }
+
+  // Times each covered pixel was written, 1 when nothing was overdrawn.
+  float overdraw_ratio() const {
+    std::int64_t const unique = unique_pixel_count();
+    return unique ? pixel_count() / static_cast<float>(unique) : 0.f;
+  }
+
+  // Share of the pixels tested in triangle bounding boxes that were inside
+  // the triangle.
+  float bbox_efficiency() const {
+    std::int64_t const tested = tested_pixel_count();
+    return tested ? covered_pixel_count() / static_cast<float>(tested) : 0.f;
+  }
+
+  // Time spent in a stage, in timestamp counter cycles and in nanoseconds,
+  // with time in nested stages counted only for them. In tiled mode the
+  // workers' times are added up, so the total can exceed the wall time.
+  // Zero unless SWGL_ENABLE_PIPELINE_TIMERS is set; cycles are also zero on
+  // targets without a timestamp counter.
+  std::int64_t stage_cycles(pipeline_stage stage) const {
+    return SWGL_ENABLE_PIPELINE_TIMERS ? stage_cycles_[static_cast<int>(stage)]
+                                       : 0;
+  }
+
+  std::int64_t stage_nanoseconds(pipeline_stage stage) const {
+    return SWGL_ENABLE_PIPELINE_TIMERS
+               ? stage_nanoseconds_[static_cast<int>(stage)]
+               : 0;
+  }
+
+  // Sums of every stage.
+  std::int64_t timed_cycles() const {
+    return SWGL_ENABLE_PIPELINE_TIMERS ? timed_cycles_ : 0;
+  }
+
+  std::int64_t timed_nanoseconds() const {
+    return SWGL_ENABLE_PIPELINE_TIMERS ? timed_nanoseconds_ : 0;
+  }
+
   pipeline_counters& operator+=(pipeline_counters const& other) {
 #if SWGL_ENABLE_PIPELINE_COUNTERS
     num_pixels_ += other.num_pixels_;
+    num_fragment_shaders_ += other.num_fragment_shaders_;
     num_triangles_ += other.num_triangles_;
+    num_lines_ += other.num_lines_;
+    num_points_ += other.num_points_;
     num_draws_ += other.num_draws_;
+    num_culled_draws_ += other.num_culled_draws_;
+    num_vertex_shaders_ += other.num_vertex_shaders_;
+    num_vertex_cache_hits_ += other.num_vertex_cache_hits_;
+    num_frustum_culled_triangles_ += other.num_frustum_culled_triangles_;
+    num_clipped_triangles_ += other.num_clipped_triangles_;
+    num_degenerate_triangles_ += other.num_degenerate_triangles_;
+    num_facing_culled_triangles_ += other.num_facing_culled_triangles_;
+    num_missed_triangles_ += other.num_missed_triangles_;
+    num_occluded_triangles_ += other.num_occluded_triangles_;
+    num_occluded_blocks_ += other.num_occluded_blocks_;
+    num_unique_pixels_ += other.num_unique_pixels_;
+    num_tested_pixels_ += other.num_tested_pixels_;
+    num_covered_pixels_ += other.num_covered_pixels_;
+#endif
+#if SWGL_ENABLE_PIPELINE_TIMERS
+    for(int stage = 0; stage < pipeline_stage_count; ++stage) {
+      stage_cycles_[stage] += other.stage_cycles_[stage];
+      stage_nanoseconds_[stage] += other.stage_nanoseconds_[stage];
+    }
+    timed_cycles_ += other.timed_cycles_;
+    timed_nanoseconds_ += other.timed_nanoseconds_;
+#endif
+#if !SWGL_ENABLE_PIPELINE_COUNTERS && !SWGL_ENABLE_PIPELINE_TIMERS
+    (void)other;
 #endif
     return *this;
   }
 
  private:
-  int num_pixels_    = 0;
-  int num_triangles_ = 0;
-  int num_draws_     = 0;
+  std::int64_t num_pixels_                   = 0;
+  std::int64_t num_fragment_shaders_         = 0;
+  std::int64_t num_triangles_                = 0;
+  std::int64_t num_lines_                    = 0;
+  std::int64_t num_points_                   = 0;
+  std::int64_t num_draws_                    = 0;
+  std::int64_t num_culled_draws_             = 0;
+  std::int64_t num_vertex_shaders_           = 0;
+  std::int64_t num_vertex_cache_hits_        = 0;
+  std::int64_t num_frustum_culled_triangles_ = 0;
+  std::int64_t num_clipped_triangles_        = 0;
+  std::int64_t num_degenerate_triangles_     = 0;
+  std::int64_t num_facing_culled_triangles_  = 0;
+  std::int64_t num_missed_triangles_         = 0;
+  std::int64_t num_occluded_triangles_       = 0;
+  std::int64_t num_occluded_blocks_          = 0;
+  std::int64_t num_unique_pixels_            = 0;
+  std::int64_t num_tested_pixels_            = 0;
+  std::int64_t num_covered_pixels_           = 0;
+
+  std::array<std::int64_t, pipeline_stage_count> stage_cycles_      = {};
+  std::array<std::int64_t, pipeline_stage_count> stage_nanoseconds_ = {};
+
+  std::int64_t timed_cycles_      = 0;
+  std::int64_t timed_nanoseconds_ = 0;
 };
 
+// Adds the time between its construction and destruction to a stage of a
+// counters object, less the time nested timers added to it meanwhile. Does
+// nothing unless SWGL_ENABLE_PIPELINE_TIMERS is set.
+#if SWGL_ENABLE_PIPELINE_TIMERS
+class stage_timer {
+ public:
+  stage_timer(pipeline_counters& counters, pipeline_stage stage)
+      : counters_(counters)
+      , stage_(stage)
+      , nested_cycles_(counters.timed_cycles())
+      , nested_nanoseconds_(counters.timed_nanoseconds())
+      , start_nanoseconds_(nanoseconds())
+      , start_cycles_(cycles()) {
+  }
+
+  ~stage_timer() {
+    std::int64_t const elapsed_cycles      = cycles() - start_cycles_;
+    std::int64_t const elapsed_nanoseconds = nanoseconds() - start_nanoseconds_;
+    counters_.add_stage_time(
+        stage_,
+        elapsed_cycles - (counters_.timed_cycles() - nested_cycles_),
+        elapsed_nanoseconds -
+            (counters_.timed_nanoseconds() - nested_nanoseconds_));
+  }
+
+  stage_timer(stage_timer const&) = delete;
+  stage_timer& operator=(stage_timer const&) = delete;
+
+ private:
+  static std::int64_t cycles() {
+#if defined(_MSC_VER) || defined(__i386__) || defined(__x86_64__)
+    return static_cast<std::int64_t>(__rdtsc());
+#else
+    return 0;
+#endif
+  }
+
+  static std::int64_t nanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::steady_clock::now().time_since_epoch())
+        .count();
+  }
+
+  pipeline_counters& counters_;
+  pipeline_stage stage_;
+  std::int64_t nested_cycles_;
+  std::int64_t nested_nanoseconds_;
+  std::int64_t start_nanoseconds_;
+  std::int64_t start_cycles_;
+};
+#else
+class stage_timer {
+ public:
+  stage_timer(pipeline_counters&, pipeline_stage) {
+  }
+};
+#endif
+
 } // namespace swgl
 
 #endif // SWGL_PIPELINE_HPP
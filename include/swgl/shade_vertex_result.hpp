@@ -10,23 +10,171 @@
 #define SWGL_SHADEVERTEXRESULT_HPP
 #pragma once
 
-//namespace swgl {
-//template <typename Ts...>
-//class tied_vertex {
-// public:
+#include "swgl/geometry/vector.hpp"
+
+#include <cstddef>
+#include <tuple>
+#include <utility>
+
+namespace swgl {
+
+// How an attribute of type T is viewed as floats.
+template <typename T>
+struct attribute_traits;
+
+template <>
+struct attribute_traits<float> {
+  static constexpr std::size_t size = 1;
+
+  static float* data(float& v) {
+    return &v;
+  }
+
+  static float const* data(float const& v) {
+    return &v;
+  }
+};
+
+template <std::size_t Dimension>
+struct attribute_traits<vector<float, Dimension>> {
+  static constexpr std::size_t size = Dimension;
+
+  static float* data(vector<float, Dimension>& v) {
+    return v.raw.data();
+  }
+
+  static float const* data(vector<float, Dimension> const& v) {
+    return v.raw.data();
+  }
+};
+
+namespace detail {
+
+template <typename Members>
+struct attribute_list;
+
+template <>
+struct attribute_list<std::tuple<>> {
+  static constexpr std::size_t size = 0;
+};
+
+template <typename Vertex, typename First, typename... Rest>
+struct attribute_list<std::tuple<First Vertex::*, Rest Vertex::*...>> {
+  static constexpr std::size_t size =
+      attribute_traits<First>::size +
+      attribute_list<std::tuple<Rest Vertex::*...>>::size;
+};
+
+template <typename Vertex, typename Fn, std::size_t... I>
+void for_each_attribute(Fn&& fn, std::index_sequence<I...>) {
+  auto const members = Vertex::attributes();
+  using expand       = int[];
+  (void)expand{0, (fn(std::get<I>(members)), 0)...};
+}
+
+template <typename Vertex, typename Fn>
+void for_each_attribute(Fn&& fn) {
+  using members = decltype(Vertex::attributes());
+  for_each_attribute<Vertex>(
+      std::forward<Fn>(fn),
+      std::make_index_sequence<std::tuple_size<members>::value>());
+}
+
+template <typename Member>
+struct member_type;
+
+template <typename Vertex, typename Member>
+struct member_type<Member Vertex::*> {
+  using type = Member;
+};
+
+} // namespace detail
+
+// Number of floats in the flat layout of a vertex output.
+template <typename Vertex>
+struct vertex_attribute_count {
+  static constexpr std::size_t value =
+      detail::attribute_list<decltype(Vertex::attributes())>::size;
+};
+
+// Vertex outputs describe their members so the pipeline can interpolate
+// them without knowing what they are. Deriving from shade_vertex_result and
+// listing every member
 //
-//  friend tied_vertex operator*(tied_vertex v, float scaler) {
-//      return v;
-//    }
+//   struct vertex_out : shade_vertex_result<vertex_out> {
+//     vector4f position = vector4f::zero();
+//     vector2f uv       = vector2f::zero();
 //
-//    friend tied_vertex operator+(tied_vertex a, tied_vertex b) {
-//      return a;
-//    }
-//};
+//     static auto attributes() {
+//       return std::make_tuple(&vertex_out::position, &vertex_out::uv);
+//     }
+//   };
 //
-//template<typename Ts..
-//tied_vertex<Ts...>
+// provides the operator* and operator+ used for clipping, and lets the
+// pipeline copy the vertex to and from a flat array of floats, laid out in
+// the order the members are listed, for its interpolation loops. Members
+// must be float or vector<float, N>.
+template <typename Derived>
+class shade_vertex_result {
+ public:
+  friend Derived operator*(Derived v, float scaler) {
+    detail::for_each_attribute<Derived>([&v, scaler](auto member) {
+      using traits = attribute_traits<
+          typename detail::member_type<decltype(member)>::type>;
+      float* data = traits::data(v.*member);
+      for(std::size_t i = 0; i < traits::size; ++i) {
+        data[i] *= scaler;
+      }
+    });
+    return v;
+  }
+
+  friend Derived operator+(Derived a, Derived const& b) {
+    detail::for_each_attribute<Derived>([&a, &b](auto member) {
+      using traits = attribute_traits<
+          typename detail::member_type<decltype(member)>::type>;
+      float* data        = traits::data(a.*member);
+      float const* other = traits::data(b.*member);
+      for(std::size_t i = 0; i < traits::size; ++i) {
+        data[i] += other[i];
+      }
+    });
+    return a;
+  }
+};
+
+// Copies a vertex output into out[0, vertex_attribute_count).
+template <typename Vertex>
+void store_attributes(Vertex const& v, float* out) {
+  static_assert(
+      sizeof(Vertex) == vertex_attribute_count<Vertex>::value * sizeof(float),
+      "every member of a vertex output must be listed in attributes()");
+  detail::for_each_attribute<Vertex>([&v, &out](auto member) {
+    using traits = attribute_traits<
+        typename detail::member_type<decltype(member)>::type>;
+    float const* data = traits::data(v.*member);
+    for(std::size_t i = 0; i < traits::size; ++i) {
+      *out++ = data[i];
+    }
+  });
+}
+
+// Fills a vertex output from in[0, vertex_attribute_count).
+template <typename Vertex>
+void load_attributes(float const* in, Vertex& v) {
+  static_assert(
+      sizeof(Vertex) == vertex_attribute_count<Vertex>::value * sizeof(float),
+      "every member of a vertex output must be listed in attributes()");
+  detail::for_each_attribute<Vertex>([&v, &in](auto member) {
+    using traits = attribute_traits<
+        typename detail::member_type<decltype(member)>::type>;
+    float* data = traits::data(v.*member);
+    for(std::size_t i = 0; i < traits::size; ++i) {
+      data[i] = *in++;
+    }
+  });
+}
 
+} // namespace swgl
 
-//} // namespace swgl
-#endif // SWGL_SHADEVERTEXRESULT_HPP
\ No newline at end of file
+#endif // SWGL_SHADEVERTEXRESULT_HPP
@@ -13,6 +13,8 @@
 #include "swgl/geometry/matrix.hpp"
 #include "swgl/geometry/vector.hpp"
 #include "swgl/pipeline_counters.hpp"
+#include "swgl/simd.hpp"
+#include "swgl/span.hpp"
 
 namespace swgl { namespace shaders {
 
@@ -34,11 +36,35 @@ class basic_lighted_model {
     return draw_impl();
   }
 
+  // Draws the model once for each transform, with draw_info::model
+  // premultiplied by it. The view dependent setup is done once for all of
+  // them, each instance is culled as a whole against the model's bounds,
+  // and the counters of all the instances are summed. Instances are drawn
+  // in order, so overlapping ones resolve as if drawn one at a time; with a
+  // thread pool each one is spread over the tiles.
+  pipeline_counters draw_instanced(
+      draw_info const& info, span<matrix4f const> instance_transforms) const {
+    prepare_for_draw(info);
+    pipeline_counters stats;
+    for(matrix4f const& transform : instance_transforms) {
+      prepare_instance(transform * info.model);
+      stats += draw_impl();
+    }
+    return stats;
+  }
+
+  // Takes model positions to the homogeneous screen space that shade_vertex
+  // outputs. The pipeline uses it to cull whole draws against the model's
+  // bounds.
+  matrix4f const& object_to_screen() const {
+    return mvpv_;
+  }
+
  protected:
   void prepare_for_draw(draw_info const& info) const {
     draw_info_ = &info;
-    mv_        = info.view * info.model;
-    mvpv_      = info.viewport * info.projection * mv_;
+    pv_        = info.viewport * info.projection;
+    prepare_instance(info.model);
 
     directional_light_cs_ = vector_narrow<3>(
         info.view * vector_widen<4>(info.directional_light, 1.f));
@@ -46,8 +72,26 @@ class basic_lighted_model {
         vector_narrow<3>(info.view * vector_widen<4>(info.point_light, 1.f));
   }
 
+  void prepare_instance(matrix4f const& model) const {
+    mv_   = draw_info_->view * model;
+    mvpv_ = pv_ * mv_;
+  }
+
+  // Row of m applied to a batch of points (x, y, z, 1), summed in the same
+  // order as matrix * vector so batched and per-vertex shading agree.
+  static simd::float_v transform_row(
+      matrix4f const& m,
+      int row,
+      simd::float_v x,
+      simd::float_v y,
+      simd::float_v z) {
+    return simd::float_v(m[row][0]) * x + simd::float_v(m[row][1]) * y +
+           simd::float_v(m[row][2]) * z + simd::float_v(m[row][3]);
+  }
+
   mutable draw_info const* draw_info_;
   mutable matrix4f mvpv_;
+  mutable matrix4f pv_;
   mutable matrix4f mv_;
   mutable vector3f directional_light_cs_;
   mutable vector3f point_light_cs_;
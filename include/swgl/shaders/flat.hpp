@@ -11,6 +11,7 @@
 #pragma once
 
 #include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
 #include "swgl/shaders/basic_lighted_model.hpp"
 
 namespace swgl { namespace shaders {
@@ -21,24 +22,19 @@ class flat : public pipeline<flat, basic_lighted_model> {
     albedo_ = &texture;
   }
 
+  image const* albedo() const {
+    return albedo_;
+  }
+
  private:
-  struct vertex_out {
-    vector3f position = vector3f::zero();
+  struct vertex_out : shade_vertex_result<vertex_out> {
+    vector4f position = vector4f::zero();
     vector2f uv       = vector2f::zero();
     float light       = 0.f;
 
-    friend vertex_out operator*(vertex_out v, float scaler) {
-      v.position *= scaler;
-      v.uv *= scaler;
-      v.light *= scaler;
-      return v;
-    }
-
-    friend vertex_out operator+(vertex_out a, vertex_out const& b) {
-      a.position += b.position;
-      a.uv += b.uv;
-      a.light += b.light;
-      return a;
+    static auto attributes() {
+      return std::make_tuple(
+          &vertex_out::position, &vertex_out::uv, &vertex_out::light);
     }
   };
 
@@ -47,9 +43,8 @@ class flat : public pipeline<flat, basic_lighted_model> {
   vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
     auto& model = get_model();
     vertex_out out;
-    vector4f proj = mvpv_ * vector_widen<4>(model.position(face, idx), 1.f);
-    out.position  = vector_narrow<3>(proj) / proj.w;
-    out.uv        = model.uv(face, idx);
+    out.position = mvpv_ * vector_widen<4>(model.position(face, idx), 1.f);
+    out.uv       = model.uv(face, idx);
 
     // Compute directional light.
     auto normal = cross(
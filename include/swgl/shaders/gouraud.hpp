@@ -12,6 +12,7 @@
 
 #include "swgl/shaders/basic_lighted_model.hpp"
 #include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
 
 namespace swgl { namespace shaders {
 
@@ -22,34 +23,26 @@ class gouraud : public pipeline<gouraud, basic_lighted_model> {
   }
 
  private:
-  struct vertex_out {
-    vector3f position = vector3f::zero();
+  struct vertex_out : shade_vertex_result<vertex_out> {
+    vector4f position = vector4f::zero();
     vector2f uv       = vector2f::zero();
     float light       = 0.f;
 
-    friend vertex_out operator*(vertex_out v, float scaler) {
-      v.position *= scaler;
-      v.uv *= scaler;
-      v.light *= scaler;
-      return v;
-    }
-
-    friend vertex_out operator+(vertex_out a, vertex_out const& b) {
-      a.position += b.position;
-      a.uv += b.uv;
-      a.light += b.light;
-      return a;
+    static auto attributes() {
+      return std::make_tuple(
+          &vertex_out::position, &vertex_out::uv, &vertex_out::light);
     }
   };
 
   friend class pipeline<gouraud, basic_lighted_model>;
 
+  static constexpr bool cache_vertices = true;
+
   vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
     auto& model = get_model();
     vertex_out out;
-    vector4f proj = mvpv_ * vector_widen<4>(model.position(face, idx), 1.f);
-    out.position  = vector_narrow<3>(proj) / proj.w;
-    out.uv        = model.uv(face, idx);
+    out.position = mvpv_ * vector_widen<4>(model.position(face, idx), 1.f);
+    out.uv       = model.uv(face, idx);
 
     vector3f light_dir(0, 0, 1);
     float intensity =
@@ -63,6 +56,45 @@ class gouraud : public pipeline<gouraud, basic_lighted_model> {
     return out;
   }
 
+  // shade_vertex for simd::float_v::width vertices at a time.
+  void shade_vertices(vertex_range range, vertex_out* out) const {
+    using simd::float_v;
+    auto const& in = get_model().unique_vertex_streams();
+    for(int first = range.first; first < range.last; first += float_v::width) {
+      float_v const x = float_v::load(&in.position[0][first]);
+      float_v const y = float_v::load(&in.position[1][first]);
+      float_v const z = float_v::load(&in.position[2][first]);
+
+      float_v intensity =
+          float_v::load(&in.normal[0][first]) *
+              float_v(directional_light_cs_.x) +
+          float_v::load(&in.normal[1][first]) *
+              float_v(directional_light_cs_.y) +
+          float_v::load(&in.normal[2][first]) *
+              float_v(directional_light_cs_.z);
+      intensity = max(float_v(0.f), intensity);
+      intensity = min(intensity + float_v(0.2f), float_v(1.f));
+
+      float position[4][float_v::width];
+      float light[float_v::width];
+      for(int c = 0; c < 4; ++c) {
+        transform_row(mvpv_, c, x, y, z).store(position[c]);
+      }
+      intensity.store(light);
+
+      int const count =
+          std::min(static_cast<int>(float_v::width), range.last - first);
+      for(int lane = 0; lane < count; ++lane) {
+        vertex_out& v = out[first - range.first + lane];
+        v.position = vector4f(
+            position[0][lane], position[1][lane], position[2][lane],
+            position[3][lane]);
+        v.uv    = vector2f(in.uv[0][first + lane], in.uv[1][first + lane]);
+        v.light = light[lane];
+      }
+    }
+  }
+
   colour<float> shade_fragment(vertex_out const& in) const {
     swgl::colour<float> light(in.light, in.light, in.light, 1.f);
     auto albedo           = albedo_->sample(in.uv.u, in.uv.v);
@@ -12,6 +12,7 @@
 
 #include "swgl/algorithm.hpp"
 #include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
 #include "swgl/shaders/basic_lighted_model.hpp"
 
 namespace swgl { namespace shaders {
@@ -23,26 +24,16 @@ class phong : public pipeline<phong, basic_lighted_model> {
   }
 
  private:
-  struct vertex_out {
+  struct vertex_out : shade_vertex_result<vertex_out> {
     vector3f cam_pos  = vector3f::zero();
-    vector3f position = vector3f::zero();
+    vector4f position = vector4f::zero();
     vector3f normal   = vector3f::zero();
     vector2f uv       = vector2f::zero();
 
-    friend vertex_out operator*(vertex_out v, float scaler) {
-      v.cam_pos *= scaler;
-      v.position *= scaler;
-      v.normal *= scaler;
-      v.uv *= scaler;
-      return v;
-    }
-
-    friend vertex_out operator+(vertex_out a, vertex_out const& b) {
-      a.cam_pos += b.cam_pos;
-      a.position += b.position;
-      a.normal += b.normal;
-      a.uv += b.uv;
-      return a;
+    static auto attributes() {
+      return std::make_tuple(
+          &vertex_out::cam_pos, &vertex_out::position, &vertex_out::normal,
+          &vertex_out::uv);
     }
   };
 
@@ -52,19 +43,59 @@ class phong : public pipeline<phong, basic_lighted_model> {
 
   friend class pipeline<phong, basic_lighted_model>;
 
+  static constexpr bool cache_vertices = true;
+
   vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
     auto& model = get_model();
     vertex_out out;
     vector4f vertex_position = vector_widen<4>(model.position(face, idx), 1.f);
 
-    vector4f proj = mvpv_ * vertex_position;
-    out.cam_pos   = vector_narrow<3>(mv_ * vertex_position);
-    out.position  = vector_narrow<3>(proj) / proj.w;
-    out.uv        = model.uv(face, idx);
-    out.normal    = vector_narrow<3>(mv_ * vector_widen<4>(model.normal(face, idx), 1.f));
+    out.cam_pos  = vector_narrow<3>(mv_ * vertex_position);
+    out.position = mvpv_ * vertex_position;
+    out.uv       = model.uv(face, idx);
+    out.normal   = vector_narrow<3>(mv_ * vector_widen<4>(model.normal(face, idx), 1.f));
     return out;
   }
 
+  // shade_vertex for simd::float_v::width vertices at a time.
+  void shade_vertices(vertex_range range, vertex_out* out) const {
+    using simd::float_v;
+    auto const& in = get_model().unique_vertex_streams();
+    for(int first = range.first; first < range.last; first += float_v::width) {
+      float_v const x  = float_v::load(&in.position[0][first]);
+      float_v const y  = float_v::load(&in.position[1][first]);
+      float_v const z  = float_v::load(&in.position[2][first]);
+      float_v const nx = float_v::load(&in.normal[0][first]);
+      float_v const ny = float_v::load(&in.normal[1][first]);
+      float_v const nz = float_v::load(&in.normal[2][first]);
+
+      float cam_pos[3][float_v::width];
+      float position[4][float_v::width];
+      float normal[3][float_v::width];
+      for(int c = 0; c < 3; ++c) {
+        transform_row(mv_, c, x, y, z).store(cam_pos[c]);
+        transform_row(mv_, c, nx, ny, nz).store(normal[c]);
+      }
+      for(int c = 0; c < 4; ++c) {
+        transform_row(mvpv_, c, x, y, z).store(position[c]);
+      }
+
+      int const count =
+          std::min(static_cast<int>(float_v::width), range.last - first);
+      for(int lane = 0; lane < count; ++lane) {
+        vertex_out& v = out[first - range.first + lane];
+        v.cam_pos =
+            vector3f(cam_pos[0][lane], cam_pos[1][lane], cam_pos[2][lane]);
+        v.position = vector4f(
+            position[0][lane], position[1][lane], position[2][lane],
+            position[3][lane]);
+        v.normal =
+            vector3f(normal[0][lane], normal[1][lane], normal[2][lane]);
+        v.uv = vector2f(in.uv[0][first + lane], in.uv[1][first + lane]);
+      }
+    }
+  }
+
   colour<float> shade_fragment(vertex_out const& in) const {
     vector3f light_dir   = (point_light_cs_ - in.cam_pos);
     float light_distance = light_dir.normalize();
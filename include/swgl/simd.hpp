@@ -0,0 +1,318 @@
+//
+// swgl/simd.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_SIMD_HPP
+#define SWGL_SIMD_HPP
+#pragma once
+
+#ifndef SWGL_ENABLE_SIMD
+#  define SWGL_ENABLE_SIMD 1
+#endif
+
+#if SWGL_ENABLE_SIMD && defined(__AVX2__)
+#  define SWGL_SIMD_AVX2 1
+#  include <immintrin.h>
+#elif SWGL_ENABLE_SIMD &&                                                      \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#  define SWGL_SIMD_SSE2 1
+#  include <emmintrin.h>
+#endif
+
+#include <cstdint>
+
+namespace swgl { namespace simd {
+
+// Thin wrappers over the widest float vector available. Without x86 SIMD
+// they degrade to a single scalar lane so the same code still compiles.
+#if SWGL_SIMD_AVX2
+
+class mask_v {
+ public:
+  explicit mask_v(__m256 m)
+      : m_(m) {
+  }
+
+  friend mask_v operator&(mask_v a, mask_v b) {
+    return mask_v(_mm256_and_ps(a.m_, b.m_));
+  }
+
+  // One bit per lane, lane 0 in the lowest bit.
+  int bits() const {
+    return _mm256_movemask_ps(m_);
+  }
+
+ private:
+  __m256 m_;
+};
+
+class float_v {
+ public:
+  static constexpr int width = 8;
+
+  explicit float_v(float f)
+      : v_(_mm256_set1_ps(f)) {
+  }
+
+  explicit float_v(__m256 v)
+      : v_(v) {
+  }
+
+  static float_v load(float const* p) {
+    return float_v(_mm256_loadu_ps(p));
+  }
+
+  // Integer loads, exact for values below 2^24.
+  static float_v load(std::uint16_t const* p) {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    return float_v(_mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v)));
+  }
+
+  static float_v load(std::uint32_t const* p) {
+    __m256i const v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+    return float_v(_mm256_cvtepi32_ps(v));
+  }
+
+  static float_v ramp() {
+    return float_v(_mm256_setr_ps(0.f, 1.f, 2.f, 3.f, 4.f, 5.f, 6.f, 7.f));
+  }
+
+  void store(float* p) const {
+    _mm256_storeu_ps(p, v_);
+  }
+
+  friend float_v operator+(float_v a, float_v b) {
+    return float_v(_mm256_add_ps(a.v_, b.v_));
+  }
+
+  friend float_v operator-(float_v a, float_v b) {
+    return float_v(_mm256_sub_ps(a.v_, b.v_));
+  }
+
+  friend float_v operator*(float_v a, float_v b) {
+    return float_v(_mm256_mul_ps(a.v_, b.v_));
+  }
+
+  friend float_v operator/(float_v a, float_v b) {
+    return float_v(_mm256_div_ps(a.v_, b.v_));
+  }
+
+  friend float_v min(float_v a, float_v b) {
+    return float_v(_mm256_min_ps(a.v_, b.v_));
+  }
+
+  friend float_v max(float_v a, float_v b) {
+    return float_v(_mm256_max_ps(a.v_, b.v_));
+  }
+
+  // Rounds towards zero. Lanes must be within the range of an int.
+  friend float_v truncate(float_v a) {
+    return float_v(_mm256_cvtepi32_ps(_mm256_cvttps_epi32(a.v_)));
+  }
+
+  friend mask_v operator>=(float_v a, float_v b) {
+    return mask_v(_mm256_cmp_ps(a.v_, b.v_, _CMP_GE_OQ));
+  }
+
+  friend mask_v operator>(float_v a, float_v b) {
+    return mask_v(_mm256_cmp_ps(a.v_, b.v_, _CMP_GT_OQ));
+  }
+
+ private:
+  __m256 v_;
+};
+
+#elif SWGL_SIMD_SSE2
+
+class mask_v {
+ public:
+  explicit mask_v(__m128 m)
+      : m_(m) {
+  }
+
+  friend mask_v operator&(mask_v a, mask_v b) {
+    return mask_v(_mm_and_ps(a.m_, b.m_));
+  }
+
+  int bits() const {
+    return _mm_movemask_ps(m_);
+  }
+
+ private:
+  __m128 m_;
+};
+
+class float_v {
+ public:
+  static constexpr int width = 4;
+
+  explicit float_v(float f)
+      : v_(_mm_set1_ps(f)) {
+  }
+
+  explicit float_v(__m128 v)
+      : v_(v) {
+  }
+
+  static float_v load(float const* p) {
+    return float_v(_mm_loadu_ps(p));
+  }
+
+  // Integer loads, exact for values below 2^24.
+  static float_v load(std::uint16_t const* p) {
+    __m128i const v = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(p));
+    return float_v(_mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128())));
+  }
+
+  static float_v load(std::uint32_t const* p) {
+    __m128i const v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p));
+    return float_v(_mm_cvtepi32_ps(v));
+  }
+
+  static float_v ramp() {
+    return float_v(_mm_setr_ps(0.f, 1.f, 2.f, 3.f));
+  }
+
+  void store(float* p) const {
+    _mm_storeu_ps(p, v_);
+  }
+
+  friend float_v operator+(float_v a, float_v b) {
+    return float_v(_mm_add_ps(a.v_, b.v_));
+  }
+
+  friend float_v operator-(float_v a, float_v b) {
+    return float_v(_mm_sub_ps(a.v_, b.v_));
+  }
+
+  friend float_v operator*(float_v a, float_v b) {
+    return float_v(_mm_mul_ps(a.v_, b.v_));
+  }
+
+  friend float_v operator/(float_v a, float_v b) {
+    return float_v(_mm_div_ps(a.v_, b.v_));
+  }
+
+  friend float_v min(float_v a, float_v b) {
+    return float_v(_mm_min_ps(a.v_, b.v_));
+  }
+
+  friend float_v max(float_v a, float_v b) {
+    return float_v(_mm_max_ps(a.v_, b.v_));
+  }
+
+  // Rounds towards zero. Lanes must be within the range of an int.
+  friend float_v truncate(float_v a) {
+    return float_v(_mm_cvtepi32_ps(_mm_cvttps_epi32(a.v_)));
+  }
+
+  friend mask_v operator>=(float_v a, float_v b) {
+    return mask_v(_mm_cmpge_ps(a.v_, b.v_));
+  }
+
+  friend mask_v operator>(float_v a, float_v b) {
+    return mask_v(_mm_cmpgt_ps(a.v_, b.v_));
+  }
+
+ private:
+  __m128 v_;
+};
+
+#else
+
+class mask_v {
+ public:
+  explicit mask_v(bool m)
+      : m_(m) {
+  }
+
+  friend mask_v operator&(mask_v a, mask_v b) {
+    return mask_v(a.m_ && b.m_);
+  }
+
+  int bits() const {
+    return m_ ? 1 : 0;
+  }
+
+ private:
+  bool m_;
+};
+
+class float_v {
+ public:
+  static constexpr int width = 1;
+
+  explicit float_v(float f)
+      : v_(f) {
+  }
+
+  static float_v load(float const* p) {
+    return float_v(*p);
+  }
+
+  static float_v load(std::uint16_t const* p) {
+    return float_v(static_cast<float>(*p));
+  }
+
+  static float_v load(std::uint32_t const* p) {
+    return float_v(static_cast<float>(*p));
+  }
+
+  static float_v ramp() {
+    return float_v(0.f);
+  }
+
+  void store(float* p) const {
+    *p = v_;
+  }
+
+  friend float_v operator+(float_v a, float_v b) {
+    return float_v(a.v_ + b.v_);
+  }
+
+  friend float_v operator-(float_v a, float_v b) {
+    return float_v(a.v_ - b.v_);
+  }
+
+  friend float_v operator*(float_v a, float_v b) {
+    return float_v(a.v_ * b.v_);
+  }
+
+  friend float_v operator/(float_v a, float_v b) {
+    return float_v(a.v_ / b.v_);
+  }
+
+  friend float_v min(float_v a, float_v b) {
+    return float_v(b.v_ < a.v_ ? b.v_ : a.v_);
+  }
+
+  friend float_v max(float_v a, float_v b) {
+    return float_v(a.v_ < b.v_ ? b.v_ : a.v_);
+  }
+
+  friend float_v truncate(float_v a) {
+    return float_v(static_cast<float>(static_cast<int>(a.v_)));
+  }
+
+  friend mask_v operator>=(float_v a, float_v b) {
+    return mask_v(a.v_ >= b.v_);
+  }
+
+  friend mask_v operator>(float_v a, float_v b) {
+    return mask_v(a.v_ > b.v_);
+  }
+
+ private:
+  float v_;
+};
+
+#endif
+
+}} // namespace swgl::simd
+
+#endif // SWGL_SIMD_HPP
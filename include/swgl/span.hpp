@@ -0,0 +1,85 @@
+//
+// swgl/span.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_SPAN_HPP
+#define SWGL_SPAN_HPP
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <type_traits>
+#include <utility>
+
+namespace swgl {
+
+// A non-owning view of a contiguous array, for interfaces that take a run of
+// values without caring how they are stored.
+template <typename T>
+class span {
+ public:
+  using element_type = T;
+  using value_type   = typename std::remove_cv<T>::type;
+  using iterator     = T*;
+
+  constexpr span() = default;
+
+  constexpr span(T* data, std::size_t size)
+      : data_(data)
+      , size_(size) {
+  }
+
+  template <std::size_t N>
+  constexpr span(T (&array)[N])
+      : data_(array)
+      , size_(N) {
+  }
+
+  // Anything with contiguous data() and size(), such as std::vector and
+  // std::array.
+  template <
+      typename Container,
+      typename = typename std::enable_if<std::is_convertible<
+          decltype(std::declval<Container&>().data()), T*>::value>::type>
+  constexpr span(Container& c)
+      : data_(c.data())
+      , size_(c.size()) {
+  }
+
+  constexpr T* data() const {
+    return data_;
+  }
+
+  constexpr std::size_t size() const {
+    return size_;
+  }
+
+  constexpr bool empty() const {
+    return size_ == 0;
+  }
+
+  constexpr iterator begin() const {
+    return data_;
+  }
+
+  constexpr iterator end() const {
+    return data_ + size_;
+  }
+
+  T& operator[](std::size_t idx) const {
+    assert(idx < size_);
+    return data_[idx];
+  }
+
+ private:
+  T* data_          = nullptr;
+  std::size_t size_ = 0;
+};
+
+} // namespace swgl
+
+#endif // SWGL_SPAN_HPP
@@ -0,0 +1,68 @@
+//
+// swgl/thread_pool.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_THREADPOOL_HPP
+#define SWGL_THREADPOOL_HPP
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace swgl {
+
+// A fixed set of worker threads that execute parallel_for jobs. The calling
+// thread takes part in each job as worker 0, so a pool of size 1 runs
+// everything inline.
+class thread_pool {
+ public:
+  using job_type = std::function<void(std::size_t worker, std::size_t index)>;
+
+  explicit thread_pool(
+      std::size_t num_workers = std::thread::hardware_concurrency());
+  ~thread_pool();
+
+  thread_pool(thread_pool const&) = delete;
+  thread_pool& operator=(thread_pool const&) = delete;
+
+  // Number of workers, including the calling thread.
+  std::size_t size() const;
+
+  // Calls job(worker, index) for every index in [0, count) and blocks until
+  // all of them have completed. Worker indices are in [0, size()). Must not
+  // be called from inside a job. If a job throws, indices that haven't
+  // started are skipped and the first exception is rethrown once every
+  // worker has stopped.
+  void parallel_for(std::size_t count, job_type const& job);
+
+ private:
+  void worker_main(std::size_t worker);
+  void run_job(std::size_t worker);
+
+  std::vector<std::thread> threads_;
+  std::mutex submit_mutex_;
+  std::mutex mutex_;
+  std::condition_variable work_ready_;
+  std::condition_variable work_done_;
+  job_type const* job_ = nullptr;
+  std::exception_ptr error_;
+  std::size_t job_count_ = 0;
+  std::atomic<std::size_t> next_index_{0};
+  std::size_t generation_ = 0;
+  std::size_t active_     = 0;
+  bool stop_              = false;
+};
+
+} // namespace swgl
+
+#endif // SWGL_THREADPOOL_HPP
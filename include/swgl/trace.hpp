@@ -0,0 +1,83 @@
+//
+// swgl/trace.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_TRACE_HPP
+#define SWGL_TRACE_HPP
+#pragma once
+
+#include <cstdint>
+#include <iosfwd>
+
+// Tracing is off by default, in which case SWGL_TRACE_SCOPE compiles to
+// nothing. Turn it on with the SWGL_ENABLE_TRACE CMake option, which also
+// builds the library with it.
+#ifndef SWGL_ENABLE_TRACE
+#  define SWGL_ENABLE_TRACE 0
+#endif
+
+#define SWGL_TRACE_CONCAT_IMPL(a, b) a##b
+#define SWGL_TRACE_CONCAT(a, b) SWGL_TRACE_CONCAT_IMPL(a, b)
+
+// Records a span from here to the end of the enclosing scope. Takes a name
+// and a category, and optionally the name and value of an integer argument,
+// all of which must be string literals apart from the value.
+#if SWGL_ENABLE_TRACE
+#  define SWGL_TRACE_SCOPE(...)                                                \
+    ::swgl::trace_scope const SWGL_TRACE_CONCAT(swgl_trace_scope_, __LINE__)( \
+        __VA_ARGS__)
+#else
+#  define SWGL_TRACE_SCOPE(...)                                                \
+    do {                                                                       \
+    } while(false)
+#endif
+
+namespace swgl {
+
+// A finished span, with times in nanoseconds since the first event.
+struct trace_event {
+  char const* name;
+  char const* category;
+  char const* arg_name;
+  std::int64_t arg;
+  std::int64_t start;
+  std::int64_t duration;
+};
+
+// Adds an event to the calling thread's buffer when it is destroyed. Each
+// thread has a ring of the most recent events that only it writes, so
+// recording never takes a lock or waits for another thread.
+class trace_scope {
+ public:
+  trace_scope(char const* name, char const* category);
+  trace_scope(
+      char const* name,
+      char const* category,
+      char const* arg_name,
+      std::int64_t arg);
+  ~trace_scope();
+
+  trace_scope(trace_scope const&) = delete;
+  trace_scope& operator=(trace_scope const&) = delete;
+
+ private:
+  trace_event event_;
+};
+
+// Writes the events of every thread that has recorded any as Chrome trace
+// event JSON, which chrome://tracing and Perfetto open. No thread may be
+// recording at the time, so call these between frames. Without
+// SWGL_ENABLE_TRACE the trace is empty.
+void write_trace(std::ostream& out);
+bool write_trace_file(char const* filename);
+
+// Drops the events recorded so far, with the same restriction.
+void clear_trace();
+
+} // namespace swgl
+
+#endif // SWGL_TRACE_HPP
@@ -0,0 +1,64 @@
+//
+// src/command_buffer.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/command_buffer.hpp"
+#include <algorithm>
+
+namespace swgl {
+
+pipeline_counters command_buffer::submit() {
+  std::vector<command> commands;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    commands.swap(commands_);
+  }
+
+  std::less<void const*> const before;
+  std::sort(
+      commands.begin(), commands.end(),
+      [&before](command const& a, command const& b) {
+        if(a.target != b.target) {
+          return before(a.target, b.target);
+        }
+        if(a.shader != b.shader) {
+          return before(a.shader, b.shader);
+        }
+        if(a.texture != b.texture) {
+          return before(a.texture, b.texture);
+        }
+        if(a.distance != b.distance) {
+          return a.distance < b.distance;
+        }
+        return a.sequence < b.sequence;
+      });
+
+  pipeline_counters stats;
+  for(auto const& cmd : commands) {
+    stats += cmd.execute();
+  }
+  return stats;
+}
+
+std::size_t command_buffer::size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return commands_.size();
+}
+
+float command_buffer::eye_distance(model const& m, draw_info const& info) {
+  vector3f const centre = vector_narrow<3>(
+      info.model * vector_widen<4>(m.bounding_sphere().centre, 1.f));
+  return (centre - info.eye).length();
+}
+
+void command_buffer::record(command cmd) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  cmd.sequence = next_sequence_++;
+  commands_.push_back(std::move(cmd));
+}
+
+} // namespace swgl
@@ -0,0 +1,102 @@
+//
+// src/depth_buffer.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/depth_buffer.hpp"
+#include <cmath>
+#include <cstring>
+
+namespace swgl {
+
+depth_buffer::depth_buffer(
+    int width, int height, depth_format format, float min_z, float max_z)
+    : width_(width)
+    , height_(height)
+    , format_(format) {
+  std::size_t const pixels = static_cast<std::size_t>(width) * height;
+  std::size_t const bytes  = pixels * bytes_per_pixel();
+  storage_.resize((bytes + sizeof(std::uint32_t) - 1) / sizeof(std::uint32_t));
+  clears_.resize(width, height);
+  set_range(min_z, max_z);
+  clear();
+}
+
+void depth_buffer::set_range(float min_z, float max_z) {
+  assert(max_z > min_z);
+  float const largest = format_ == depth_format::unorm16
+                            ? unorm16_depth::largest()
+                            : unorm24_depth::largest();
+  scale_ = (largest - 1.f) / (max_z - min_z);
+  bias_  = 1.f - min_z * scale_;
+  // Rounding can leave max_z a step short of largest. Err on the high side
+  // instead, which the clamp in encode takes up.
+  while(max_z * scale_ + bias_ < largest) {
+    scale_ = std::nextafter(scale_, std::numeric_limits<float>::max());
+    bias_  = 1.f - min_z * scale_;
+  }
+}
+
+void depth_buffer::clear() {
+  clears_.reset();
+  if(format_ == depth_format::float32) {
+    float* depth = static_cast<float*>(data());
+    std::fill(
+        depth, depth + static_cast<std::size_t>(width_) * height_,
+        -std::numeric_limits<float>::max());
+  }
+  else {
+    std::memset(storage_.data(), 0, storage_.size() * sizeof(std::uint32_t));
+  }
+}
+
+void depth_buffer::resolve_clear(int min_x, int min_y, int max_x, int max_y) {
+  clears_.resolve(
+      min_x, min_y, max_x, max_y,
+      [this](int x0, int y0, int x1, int y1) { clear_tile(x0, y0, x1, y1); });
+}
+
+void depth_buffer::resolve_clear() {
+  clears_.resolve_all(
+      [this](int x0, int y0, int x1, int y1) { clear_tile(x0, y0, x1, y1); });
+}
+
+void depth_buffer::clear_tile(int x0, int y0, int x1, int y1) {
+  std::size_t const bpp = bytes_per_pixel();
+  for(int y = y0; y < y1; ++y) {
+    std::size_t const first = static_cast<std::size_t>(y) * width_ + x0;
+    if(format_ == depth_format::float32) {
+      float* row = static_cast<float*>(data()) + first;
+      std::fill(row, row + (x1 - x0), -std::numeric_limits<float>::max());
+    }
+    else {
+      std::memset(
+          static_cast<unsigned char*>(data()) + first * bpp, 0,
+          (x1 - x0) * bpp);
+    }
+  }
+}
+
+float depth_buffer::get(int x, int y) const {
+  assert(x >= 0 && y >= 0 && x < width_ && y < height_);
+  if(clears_.pending(x, y)) {
+    return -std::numeric_limits<float>::max();
+  }
+
+  std::size_t const i = static_cast<std::size_t>(y) * width_ + x;
+  switch(format_) {
+    case depth_format::unorm24:
+      return unorm24_depth(scale_, bias_)
+          .decode(static_cast<std::uint32_t const*>(data())[i]);
+    case depth_format::unorm16:
+      return unorm16_depth(scale_, bias_)
+          .decode(static_cast<std::uint16_t const*>(data())[i]);
+    default:
+      return static_cast<float const*>(data())[i];
+  }
+}
+
+} // namespace swgl
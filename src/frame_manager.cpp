@@ -0,0 +1,169 @@
+//
+// src/frame_manager.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/frame_manager.hpp"
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+namespace swgl {
+
+frame_manager::frame_manager(
+    int width, int height, int bpp, std::size_t buffers)
+    : width_(width)
+    , height_(height)
+    , bpp_(bpp)
+    , clear_colour_(0, 0, 0, 255) {
+  buffers = std::max<std::size_t>(buffers, 2);
+  slots_.reserve(buffers);
+  for(std::size_t i = 0; i < buffers; ++i) {
+    slots_.emplace_back(new slot);
+  }
+  worker_ = std::thread([this] { worker_main(); });
+}
+
+frame_manager::~frame_manager() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  slot_changed_.notify_all();
+  worker_.join();
+}
+
+void frame_manager::resize(int width, int height) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  width_  = width;
+  height_ = height;
+}
+
+int frame_manager::width() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return width_;
+}
+
+int frame_manager::height() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return height_;
+}
+
+void frame_manager::set_clear_colour(image::colour_type const& c) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  clear_colour_ = c;
+}
+
+void frame_manager::set_depth_format(depth_format format) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  depth_format_ = format;
+}
+
+void frame_manager::submit(render_function render) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  slot& s = *slots_[submit_index_];
+  slot_changed_.wait(lock, [&s] { return s.state == slot_state::free; });
+
+  s.render        = std::move(render);
+  s.clear_colour  = clear_colour_;
+  s.depth         = depth_format_;
+  s.width         = width_;
+  s.height        = height_;
+  s.target.number = next_number_++;
+  s.error         = nullptr;
+  s.state         = slot_state::queued;
+  submit_index_   = (submit_index_ + 1) % slots_.size();
+  lock.unlock();
+  slot_changed_.notify_all();
+}
+
+frame_manager::frame const* frame_manager::acquire() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  slot& s = *slots_[acquire_index_];
+  assert(s.state != slot_state::acquired && "release the previous frame");
+  if(s.state == slot_state::free) {
+    return nullptr;
+  }
+
+  slot_changed_.wait(lock, [&s] { return s.state == slot_state::rendered; });
+  s.state = slot_state::acquired;
+  if(s.error) {
+    std::exception_ptr error = std::move(s.error);
+    lock.unlock();
+    release();
+    std::rethrow_exception(error);
+  }
+  return &s.target;
+}
+
+void frame_manager::release() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot& s = *slots_[acquire_index_];
+    assert(s.state == slot_state::acquired);
+    s.state        = slot_state::free;
+    acquire_index_ = (acquire_index_ + 1) % slots_.size();
+  }
+  slot_changed_.notify_all();
+}
+
+void frame_manager::worker_main() {
+  while(true) {
+    slot* s = nullptr;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      slot_changed_.wait(lock, [this] {
+        return stop_ || slots_[render_index_]->state == slot_state::queued;
+      });
+
+      if(stop_) {
+        return;
+      }
+
+      s             = slots_[render_index_].get();
+      render_index_ = (render_index_ + 1) % slots_.size();
+    }
+
+    // The slot is ours until it is marked rendered; nothing else touches a
+    // queued slot.
+    try {
+      render(*s);
+    }
+    catch(...) {
+      s->error = std::current_exception();
+    }
+    s->render = nullptr;
+
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      s->state = slot_state::rendered;
+    }
+    slot_changed_.notify_all();
+  }
+}
+
+void frame_manager::render(slot& s) const {
+  frame& f = s.target;
+  if(f.colour.width() != s.width || f.colour.height() != s.height ||
+     f.colour.bytespp() != bpp_) {
+    f.colour = image(s.width, s.height, bpp_);
+  }
+
+  if(f.depth.width() != s.width || f.depth.height() != s.height ||
+     f.depth.format() != s.depth) {
+    f.depth = depth_buffer(s.width, s.height, s.depth);
+  }
+
+  f.colour.fast_clear(s.clear_colour);
+  f.depth.fast_clear();
+  f.counters = s.render(f);
+
+  // The caller reads the whole colour buffer, so the tiles nothing was
+  // drawn to are cleared here, on the worker. Depth is left as it is.
+  f.colour.resolve_clear();
+}
+
+} // namespace swgl
@@ -8,7 +8,9 @@
 //
 #include "swgl/image.hpp"
 #include "swgl/colour.hpp"
+#include "swgl/trace.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -51,13 +53,16 @@ image::image(int w, int h, int bpp)
   unsigned long nbytes = width_ * height_ * bytespp_;
   data_                = new unsigned char[nbytes];
   std::memset(data_, 0, nbytes);
+  clears_.resize(width_, height_);
 }
 
 image::image(const image& img)
     : data_(NULL)
     , width_(img.width_)
     , height_(img.height_)
-    , bytespp_(img.bytespp_) {
+    , bytespp_(img.bytespp_)
+    , clear_colour_(img.clear_colour_)
+    , clears_(img.clears_) {
   unsigned long nbytes = width_ * height_ * bytespp_;
   data_                = new unsigned char[nbytes];
   std::memcpy(data_, img.data_, nbytes);
@@ -75,6 +80,8 @@ image& image::operator=(const image& img) {
     width_               = img.width_;
     height_              = img.height_;
     bytespp_             = img.bytespp_;
+    clear_colour_        = img.clear_colour_;
+    clears_              = img.clears_;
     unsigned long nbytes = width_ * height_ * bytespp_;
     data_                = new unsigned char[nbytes];
     std::memcpy(data_, img.data_, nbytes);
@@ -84,6 +91,9 @@ image& image::operator=(const image& img) {
 
 image::colour_type image::get(int x, int y) const {
   assert(!(!data_ || x < 0 || y < 0 || x >= width_ || y >= height_));
+  if(clears_.pending(x, y)) {
+    return clear_colour_;
+  }
   return colour_type(data_ + (x + y * width_) * bytespp_, bytespp_);
 }
 
@@ -93,6 +103,7 @@ image::colour_type image::sample(float u, float v) const {
 
 void image::set(int x, int y, colour_type const& c) {
   assert(!(!data_ || x < 0 || y < 0 || x >= width_ || y >= height_));
+  assert(!clears_.pending(x, y));
   std::copy(c.data(), c.data() + bytespp_, data_ + (x + y * width_) * bytespp_);
 }
 
@@ -109,6 +120,7 @@ int image::height() const {
 }
 
 bool image::read_tga_file(const char* filename) {
+  SWGL_TRACE_SCOPE("read_tga_file", "io");
   if(data_)
     delete[] data_;
   data_ = NULL;
@@ -137,6 +149,7 @@ bool image::read_tga_file(const char* filename) {
   }
   unsigned long nbytes = bytespp_ * width_ * height_;
   data_                = new unsigned char[nbytes];
+  clears_.resize(width_, height_);
   if(3 == header.datatypecode || 2 == header.datatypecode) {
     in.read((char*)data_, nbytes);
     if(!in.good()) {
@@ -225,6 +238,7 @@ bool image::load_rle_data(std::istream& in) {
 }
 
 bool image::write_tga_file(const char* filename, bool rle) {
+  resolve_clear();
   unsigned char developer_area_ref[4] = {0, 0, 0, 0};
   unsigned char extension_area_ref[4] = {0, 0, 0, 0};
   unsigned char footer[18] = {'T', 'R', 'U', 'E', 'V', 'I', 'S', 'I', 'O',
@@ -335,6 +349,7 @@ bool image::unload_rle_data(std::ostream& out) {
 bool image::flip_horizontally() {
   if(!data_)
     return false;
+  resolve_clear();
   int half = width_ >> 1;
   for(int i = 0; i < half; i++) {
     for(int j = 0; j < height_; j++) {
@@ -350,6 +365,7 @@ bool image::flip_horizontally() {
 bool image::flip_vertically() {
   if(!data_)
     return false;
+  resolve_clear();
   unsigned long bytes_per_line = width_ * bytespp_;
   unsigned char* line          = new unsigned char[bytes_per_line];
   int half                     = height_ >> 1;
@@ -364,26 +380,80 @@ bool image::flip_vertically() {
   return true;
 }
 
+unsigned char* image::data() {
+  return data_;
+}
+
 unsigned char const* image::data() const {
+  assert(!clear_pending());
   return data_;
 }
 
 void image::clear() {
+  clears_.reset();
   memset((void*)data_, 0, width_ * height_ * bytespp_);
 }
 
 void image::clear(colour_type const& c) {
-  std::size_t k = 0;
-  for(std::size_t i = 0; i < width_ * height_; ++i) {
-    for(std::size_t j = 0; j < bytespp_; ++j) {
-      data_[k++] = c[j];
-    }
+  clears_.reset();
+  fill(data_, static_cast<std::size_t>(width_) * height_, c);
+}
+
+void image::fast_clear(colour_type const& c) {
+  clear_colour_ = c;
+  clears_.mark_all();
+}
+
+void image::resolve_clear(int min_x, int min_y, int max_x, int max_y) {
+  clears_.resolve(
+      min_x, min_y, max_x, max_y,
+      [this](int x0, int y0, int x1, int y1) { fill_tile(x0, y0, x1, y1); });
+}
+
+void image::resolve_clear() {
+  clears_.resolve_all(
+      [this](int x0, int y0, int x1, int y1) { fill_tile(x0, y0, x1, y1); });
+}
+
+void image::discard_clear() {
+  clears_.reset();
+}
+
+// Writes count pixels of c from dst. The first pixel is written a byte at a
+// time and then copied in doubling chunks, so wide fills run at memcpy
+// speed whatever the pixel size.
+void image::fill(unsigned char* dst, std::size_t count, colour_type const& c) {
+  std::size_t const bytes = count * bytespp_;
+  if(!bytes) {
+    return;
+  }
+
+  for(int j = 0; j < bytespp_; ++j) {
+    dst[j] = c[j];
+  }
+
+  for(std::size_t done = bytespp_; done < bytes;) {
+    std::size_t const chunk = std::min(done, bytes - done);
+    std::memcpy(dst + done, dst, chunk);
+    done += chunk;
+  }
+}
+
+// Fills the first row of the tile and copies it to the rest.
+void image::fill_tile(int x0, int y0, int x1, int y1) {
+  std::size_t const stride   = static_cast<std::size_t>(width_) * bytespp_;
+  std::size_t const bytes    = static_cast<std::size_t>(x1 - x0) * bytespp_;
+  unsigned char* const first = data_ + (x0 + y0 * width_) * bytespp_;
+  fill(first, x1 - x0, clear_colour_);
+  for(int y = y0 + 1; y < y1; ++y) {
+    std::memcpy(first + (y - y0) * stride, first, bytes);
   }
 }
 
 bool image::scale(int w, int h) {
   if(w <= 0 || h <= 0 || !data_)
     return false;
+  resolve_clear();
   unsigned char* tdata_    = new unsigned char[w * h * bytespp_];
   int nscanline            = 0;
   int oscanline            = 0;
@@ -416,6 +486,7 @@ bool image::scale(int w, int h) {
   data_   = tdata_;
   width_  = w;
   height_ = h;
+  clears_.resize(width_, height_);
   return true;
 }
 
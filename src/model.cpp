@@ -7,9 +7,12 @@
 // file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
 //
 #include "swgl/model.hpp"
+#include "swgl/trace.hpp"
 #include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -17,6 +20,7 @@
 namespace swgl {
 
 model::model(std::istream& in) {
+  SWGL_TRACE_SCOPE("model", "io");
   std::string line;
   while(!in.eof()) {
     std::getline(in, line);
@@ -95,6 +99,62 @@ model::model(std::istream& in) {
     }
   }
 
+  if(!positions_.empty()) {
+    bounds_ = bbox<float, 3>(positions_.data(), positions_.size());
+    bounding_sphere_.centre = (bounds_.min() + bounds_.max()) * 0.5f;
+    for(auto const& p : positions_) {
+      bounding_sphere_.radius = std::max(
+          bounding_sphere_.radius,
+          (p - bounding_sphere_.centre).length_sq());
+    }
+    bounding_sphere_.radius = std::sqrt(bounding_sphere_.radius);
+  }
+
+  std::map<std::array<int, 3>, int> unique;
+  std::vector<std::array<int, 3>> unique_keys;
+  idx_unique_.resize(idx_position_.size());
+  for(std::size_t f = 0; f < idx_position_.size(); ++f) {
+    for(int i = 0; i < 3; ++i) {
+      std::array<int, 3> key = {
+          idx_position_[f][i], f < idx_uv_.size() ? idx_uv_[f][i] : -1,
+          f < idx_normal_.size() ? idx_normal_[f][i] : -1};
+      idx_unique_[f][i] =
+          unique.insert(std::make_pair(key, num_unique_)).first->second;
+      if(idx_unique_[f][i] == num_unique_) {
+        unique_keys.push_back(key);
+        ++num_unique_;
+      }
+    }
+  }
+
+  int const padding = vertex_streams::padding;
+  int const padded  = (num_unique_ + padding - 1) / padding * padding;
+  for(auto& stream : unique_streams_.position) {
+    stream.assign(padded, 0.f);
+  }
+  for(auto& stream : unique_streams_.uv) {
+    stream.assign(padded, 0.f);
+  }
+  for(auto& stream : unique_streams_.normal) {
+    stream.assign(padded, 0.f);
+  }
+
+  for(int v = 0; v < num_unique_; ++v) {
+    std::array<int, 3> const& key = unique_keys[v];
+    for(int c = 0; c < 3; ++c) {
+      unique_streams_.position[c][v] = positions_[key[0]][c];
+    }
+    if(key[1] >= 0) {
+      unique_streams_.uv[0][v] = uvs_[key[1]].u;
+      unique_streams_.uv[1][v] = uvs_[key[1]].v;
+    }
+    if(key[2] >= 0) {
+      for(int c = 0; c < 3; ++c) {
+        unique_streams_.normal[c][v] = normals_[key[2]][c];
+      }
+    }
+  }
+
   std::cerr << "# v# " << positions_.size() << " f# " << idx_position_.size()
             << std::endl;
 }
@@ -121,4 +181,24 @@ vector2f model::uv(int face, int idx) const {
   return uvs_[idx_uv_[face][idx]];
 }
 
+bbox<float, 3> const& model::bounds() const {
+  return bounds_;
+}
+
+model::sphere const& model::bounding_sphere() const {
+  return bounding_sphere_;
+}
+
+int model::nunique_verts() const {
+  return num_unique_;
+}
+
+int model::unique_vertex(int face, int idx) const {
+  return idx_unique_[face][idx];
+}
+
+model::vertex_streams const& model::unique_vertex_streams() const {
+  return unique_streams_;
+}
+
 } // namespace swgl
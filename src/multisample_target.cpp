@@ -0,0 +1,114 @@
+//
+// src/multisample_target.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/multisample_target.hpp"
+#include "swgl/simd.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+
+namespace swgl {
+
+namespace {
+
+static_assert(
+    multisample_target::sample_count == 4 &&
+        sizeof(multisample_target::colour_type) == 4,
+    "resolve assumes four RGBA8 samples per pixel");
+
+// Rounded average of the four samples of a pixel, in[0, 16) to out[0, 4).
+void resolve_pixel(std::uint8_t const* in, std::uint8_t* out) {
+  for(int c = 0; c < 4; ++c) {
+    out[c] = static_cast<std::uint8_t>(
+        (in[c] + in[4 + c] + in[8 + c] + in[12 + c] + 2) >> 2);
+  }
+}
+
+#if SWGL_SIMD_AVX2 || SWGL_SIMD_SSE2
+// Sums of the channels of samples 0 + 2 and 1 + 3 of one pixel, as 16 bit
+// lanes.
+__m128i pair_sums(std::uint8_t const* in) {
+  __m128i const zero = _mm_setzero_si128();
+  __m128i const samples =
+      _mm_loadu_si128(reinterpret_cast<__m128i const*>(in));
+  return _mm_add_epi16(
+      _mm_unpacklo_epi8(samples, zero), _mm_unpackhi_epi8(samples, zero));
+}
+
+// Resolves two pixels into 16 bit lanes.
+__m128i resolve_pair(std::uint8_t const* in) {
+  __m128i const a     = pair_sums(in);
+  __m128i const b     = pair_sums(in + 16);
+  __m128i const total = _mm_add_epi16(
+      _mm_unpacklo_epi64(a, b), _mm_unpackhi_epi64(a, b));
+  return _mm_srli_epi16(_mm_add_epi16(total, _mm_set1_epi16(2)), 2);
+}
+
+// Resolves four pixels, in[0, 64) to out[0, 16).
+void resolve_quad(std::uint8_t const* in, std::uint8_t* out) {
+  __m128i const resolved =
+      _mm_packus_epi16(resolve_pair(in), resolve_pair(in + 32));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), resolved);
+}
+#else
+void resolve_quad(std::uint8_t const* in, std::uint8_t* out) {
+  for(int i = 0; i < 4; ++i) {
+    resolve_pixel(in + i * 16, out + i * 4);
+  }
+}
+#endif
+
+} // namespace
+
+multisample_target::multisample_target(int width, int height)
+    : width_(width)
+    , height_(height)
+    , colour_(
+          static_cast<std::size_t>(width) * height * sample_count,
+          colour_type(0, 0, 0, 255))
+    , depth_(
+          static_cast<std::size_t>(width) * height * sample_count,
+          -std::numeric_limits<float>::max()) {
+}
+
+void multisample_target::clear(colour_type const& c) {
+  std::fill(colour_.begin(), colour_.end(), c);
+  std::fill(depth_.begin(), depth_.end(), -std::numeric_limits<float>::max());
+}
+
+void multisample_target::resolve(image& out) const {
+  assert(out.width() == width_ && out.height() == height_);
+  // Every pixel is written below, so a pending clear would only be
+  // overwritten.
+  out.discard_clear();
+  int const bpp            = out.bytespp();
+  std::size_t const pixels = static_cast<std::size_t>(width_) * height_;
+  unsigned char* dst       = out.data();
+  std::uint8_t const* in =
+      reinterpret_cast<std::uint8_t const*>(colour_.data());
+
+  // Four pixels at a time, written straight out when the image is RGBA.
+  std::size_t i = 0;
+  for(; i + 4 <= pixels; i += 4, in += 64, dst += 4 * bpp) {
+    std::uint8_t resolved[16];
+    resolve_quad(in, bpp == image::RGBA ? dst : resolved);
+    if(bpp != image::RGBA) {
+      for(int p = 0; p < 4; ++p) {
+        std::copy(resolved + p * 4, resolved + p * 4 + bpp, dst + p * bpp);
+      }
+    }
+  }
+
+  for(; i < pixels; ++i, in += 16, dst += bpp) {
+    std::uint8_t resolved[4];
+    resolve_pixel(in, resolved);
+    std::copy(resolved, resolved + bpp, dst);
+  }
+}
+
+} // namespace swgl
@@ -0,0 +1,113 @@
+//
+// src/thread_pool.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/thread_pool.hpp"
+#include <algorithm>
+#include <utility>
+
+namespace swgl {
+
+thread_pool::thread_pool(std::size_t num_workers) {
+  num_workers = std::max<std::size_t>(num_workers, 1);
+  threads_.reserve(num_workers - 1);
+  for(std::size_t i = 1; i < num_workers; ++i) {
+    threads_.emplace_back([this, i] { worker_main(i); });
+  }
+}
+
+thread_pool::~thread_pool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_ready_.notify_all();
+  for(auto& t : threads_) {
+    t.join();
+  }
+}
+
+std::size_t thread_pool::size() const {
+  return threads_.size() + 1;
+}
+
+void thread_pool::parallel_for(std::size_t count, job_type const& job) {
+  if(count == 0) {
+    return;
+  }
+
+  if(threads_.empty() || count == 1) {
+    for(std::size_t i = 0; i < count; ++i) {
+      job(0, i);
+    }
+    return;
+  }
+
+  std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    job_       = &job;
+    job_count_ = count;
+    next_index_.store(0, std::memory_order_relaxed);
+    active_ = threads_.size();
+    ++generation_;
+  }
+  work_ready_.notify_all();
+
+  run_job(0);
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this] { return active_ == 0; });
+  job_ = nullptr;
+  if(error_) {
+    std::rethrow_exception(std::exchange(error_, nullptr));
+  }
+}
+
+void thread_pool::worker_main(std::size_t worker) {
+  std::size_t seen_generation = 0;
+  while(true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_ready_.wait(lock, [this, seen_generation] {
+        return stop_ || generation_ != seen_generation;
+      });
+
+      if(stop_) {
+        return;
+      }
+
+      seen_generation = generation_;
+    }
+
+    run_job(worker);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if(--active_ == 0) {
+      work_done_.notify_one();
+    }
+  }
+}
+
+void thread_pool::run_job(std::size_t worker) {
+  for(std::size_t i = next_index_.fetch_add(1); i < job_count_;
+      i             = next_index_.fetch_add(1)) {
+    try {
+      (*job_)(worker, i);
+    } catch(...) {
+      // Keep the first exception for parallel_for to rethrow, and stop
+      // handing out the iterations that haven't started.
+      std::lock_guard<std::mutex> lock(mutex_);
+      if(!error_) {
+        error_ = std::current_exception();
+      }
+      next_index_.store(job_count_);
+    }
+  }
+}
+
+} // namespace swgl
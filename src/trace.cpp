@@ -0,0 +1,152 @@
+//
+// src/trace.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#include "swgl/trace.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace swgl {
+
+namespace {
+
+// Events kept per thread. Older ones are overwritten.
+constexpr std::size_t ring_size = 1 << 16;
+
+struct thread_ring {
+  explicit thread_ring(int tid)
+      : tid(tid)
+      , events(ring_size) {
+  }
+
+  int tid;
+  // Events written so far. Only the owning thread stores to it.
+  std::atomic<std::uint64_t> head{0};
+  // Where the trace starts after clear_trace.
+  std::uint64_t first = 0;
+  std::vector<trace_event> events;
+};
+
+// Every thread's ring, kept alive after the thread exits so its events can
+// still be written out.
+struct ring_registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<thread_ring>> rings;
+};
+
+ring_registry& registry() {
+  static ring_registry r;
+  return r;
+}
+
+thread_ring& local_ring() {
+  thread_local std::shared_ptr<thread_ring> const ring = [] {
+    ring_registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    r.rings.push_back(
+        std::make_shared<thread_ring>(static_cast<int>(r.rings.size()) + 1));
+    return r.rings.back();
+  }();
+  return *ring;
+}
+
+std::int64_t now() {
+  static auto const epoch = std::chrono::steady_clock::now();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now() - epoch)
+      .count();
+}
+
+void record(trace_event const& event) {
+  thread_ring& ring         = local_ring();
+  std::uint64_t const index = ring.head.load(std::memory_order_relaxed);
+  ring.events[index % ring_size] = event;
+  ring.head.store(index + 1, std::memory_order_release);
+}
+
+// Chrome wants microseconds, and takes fractions of them.
+void write_microseconds(std::ostream& out, std::int64_t ns) {
+  char buffer[32];
+  std::snprintf(
+      buffer, sizeof(buffer), "%lld.%03lld",
+      static_cast<long long>(ns / 1000), static_cast<long long>(ns % 1000));
+  out << buffer;
+}
+
+} // namespace
+
+trace_scope::trace_scope(char const* name, char const* category)
+    : trace_scope(name, category, nullptr, 0) {
+}
+
+trace_scope::trace_scope(
+    char const* name,
+    char const* category,
+    char const* arg_name,
+    std::int64_t arg)
+    : event_{name, category, arg_name, arg, now(), 0} {
+}
+
+trace_scope::~trace_scope() {
+  event_.duration = now() - event_.start;
+  record(event_);
+}
+
+void write_trace(std::ostream& out) {
+  out << "{\"traceEvents\":[";
+  bool first_event = true;
+  ring_registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for(auto const& ring : r.rings) {
+    std::uint64_t const head = ring->head.load(std::memory_order_acquire);
+    std::uint64_t const begin =
+        std::max(ring->first, head > ring_size ? head - ring_size : 0);
+    for(std::uint64_t i = begin; i < head; ++i) {
+      trace_event const& e = ring->events[i % ring_size];
+      out << (first_event ? "\n" : ",\n");
+      out << "{\"name\":\"" << e.name << "\",\"cat\":\"" << e.category
+          << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":";
+      write_microseconds(out, e.start);
+      out << ",\"dur\":";
+      write_microseconds(out, e.duration);
+      if(e.arg_name) {
+        out << ",\"args\":{\"" << e.arg_name << "\":" << e.arg << "}";
+      }
+      out << "}";
+      first_event = false;
+    }
+  }
+  out << (first_event ? "" : "\n") << "],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+bool write_trace_file(char const* filename) {
+  std::ofstream out(filename);
+  if(!out.is_open()) {
+    std::cerr << "can't open file " << filename << "\n";
+    return false;
+  }
+
+  write_trace(out);
+  return out.good();
+}
+
+void clear_trace() {
+  ring_registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  for(auto const& ring : r.rings) {
+    ring->first = ring->head.load(std::memory_order_acquire);
+  }
+}
+
+} // namespace swgl
@@ -0,0 +1,206 @@
+//
+// test/clip.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE clip
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/geometry/clip.hpp"
+#include "swgl/image.hpp"
+#include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
+
+#include <cmath>
+
+namespace {
+
+constexpr int target_size  = 64;
+constexpr float guard_band = 4096.f;
+
+// Model positions are taken as homogeneous (x, y, w), already in the
+// viewport's space, so a face can put a vertex behind the eye.
+class homogeneous : public swgl::pipeline<homogeneous> {
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector4f position = swgl::vector4f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<homogeneous>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    swgl::vector3f const p = get_model().position(face, idx);
+    vertex_out out;
+    out.position = swgl::vector4f(p.x, p.y, 1.f, p.z);
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    return swgl::colour<float>(1.f, 1.f, 1.f, 1.f);
+  }
+};
+
+struct clip_vertex {
+  swgl::vector4f position;
+
+  friend clip_vertex operator*(clip_vertex v, float s) {
+    v.position = v.position * s;
+    return v;
+  }
+
+  friend clip_vertex operator+(clip_vertex a, clip_vertex const& b) {
+    a.position = a.position + b.position;
+    return a;
+  }
+};
+
+bool is_finite(swgl::vector4f const& p) {
+  return std::isfinite(p.x) && std::isfinite(p.y) && std::isfinite(p.z) &&
+         std::isfinite(p.w);
+}
+
+// Two vertices at w = 1 across y = 16 and a third behind the eye at w = -1.
+// Dividing the third by its w would put it at (32, 48), below the edge;
+// the part of the triangle in front of the eye runs away from it instead,
+// above y = 16.
+char const* const crossing_triangle =
+    "v 16 16 1\n"
+    "v 48 16 1\n"
+    "v -32 -48 -1\n"
+    "f 1 2 3\n";
+
+struct target {
+  target()
+      : rt(target_size, target_size, swgl::image::RGB)
+      , depth(target_size, target_size) {
+    rt.clear(swgl::image::colour_type(0, 0, 0, 255));
+    depth.clear();
+  }
+
+  swgl::image rt;
+  swgl::depth_buffer depth;
+};
+
+swgl::pipeline_counters draw(target& t, swgl::model const& m) {
+  homogeneous pipeline;
+  pipeline.set_model(m);
+  pipeline.set_render_target(t.rt);
+  pipeline.set_depth(t.depth);
+  pipeline.set_cull_mode(swgl::cull_mode::none);
+  return pipeline.draw();
+}
+
+int count_set_pixels(swgl::image const& rt) {
+  int count = 0;
+  for(int y = 0; y < rt.height(); ++y) {
+    for(int x = 0; x < rt.width(); ++x) {
+      count += rt.get(x, y).r() != 0;
+    }
+  }
+  return count;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(clip_polygon_behind_eye) {
+  swgl::clip_volume const volume(
+      0.f, 0.f, target_size, target_size, guard_band);
+  clip_vertex polygon[2][3 + swgl::clip_volume::plane_count] = {
+      {{swgl::vector4f(16.f, 16.f, 1.f, 1.f)},
+       {swgl::vector4f(48.f, 16.f, 1.f, 1.f)},
+       {swgl::vector4f(-32.f, -48.f, 1.f, -1.f)}}};
+  int count = 3;
+  int src   = 0;
+  for(int plane = 0; plane < swgl::clip_volume::plane_count; ++plane) {
+    count = swgl::clip_polygon(
+        volume, plane, polygon[src], count, polygon[src ^ 1]);
+    src ^= 1;
+  }
+
+  BOOST_TEST(count >= 3);
+  for(int i = 0; i < count; ++i) {
+    swgl::vector4f const& p = polygon[src][i].position;
+    BOOST_TEST_CONTEXT("vertex " << i) {
+      BOOST_TEST(is_finite(p));
+      BOOST_TEST(p.w >= swgl::clip_volume::near_w * 0.999f);
+      float const x = p.x / p.w;
+      float const y = p.y / p.w;
+      BOOST_TEST(std::isfinite(x));
+      BOOST_TEST(std::isfinite(y));
+      BOOST_TEST(x >= -guard_band - 1.f);
+      BOOST_TEST(x <= target_size + guard_band + 1.f);
+      BOOST_TEST(y >= -guard_band - 1.f);
+      BOOST_TEST(y <= 17.f);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(triangle_crossing_the_eye) {
+  swgl::model const m = swgl::test::model_from_obj(crossing_triangle);
+  target t;
+  swgl::pipeline_counters const counters = draw(t, m);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+  BOOST_TEST(counters.clipped_triangle_count() == 1);
+#endif
+
+  // Nothing wraps round to the far side of the edge, and every depth
+  // written is a number.
+  int drawn = 0;
+  for(int y = 0; y < target_size; ++y) {
+    for(int x = 0; x < target_size; ++x) {
+      if(t.rt.get(x, y).r() == 0) {
+        continue;
+      }
+      ++drawn;
+      BOOST_TEST_CONTEXT("pixel " << x << ", " << y) {
+        BOOST_TEST(y <= 16);
+        BOOST_TEST(std::isfinite(t.depth.get(x, y)));
+      }
+    }
+  }
+  BOOST_TEST(drawn > 0);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+  BOOST_TEST(drawn == counters.pixel_count());
+#endif
+}
+
+// A triangle past the target on every side but inside the guard band is
+// rasterised whole.
+BOOST_AUTO_TEST_CASE(guard_band_is_not_clipped) {
+  swgl::model const m = swgl::test::model_from_obj(
+      "v -100 -100 1\n"
+      "v 300 -100 1\n"
+      "v -100 300 1\n"
+      "f 1 2 3\n");
+  target t;
+  swgl::pipeline_counters const counters = draw(t, m);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+  BOOST_TEST(counters.clipped_triangle_count() == 0);
+#endif
+  BOOST_TEST(count_set_pixels(t.rt) == target_size * target_size);
+}
+
+// Past the guard band the triangle is clipped, and still covers the target.
+BOOST_AUTO_TEST_CASE(beyond_guard_band_is_clipped) {
+  swgl::model const m = swgl::test::model_from_obj(
+      "v -10000 -10000 1\n"
+      "v 30000 -10000 1\n"
+      "v -10000 30000 1\n"
+      "f 1 2 3\n");
+  target t;
+  swgl::pipeline_counters const counters = draw(t, m);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+  BOOST_TEST(counters.clipped_triangle_count() == 1);
+#endif
+  BOOST_TEST(count_set_pixels(t.rt) == target_size * target_size);
+}
@@ -0,0 +1,159 @@
+//
+// test/command_buffer.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE command_buffer
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/command_buffer.hpp"
+#include "swgl/depth_buffer.hpp"
+#include "swgl/shaders/gouraud.hpp"
+#include "swgl/shaders/phong.hpp"
+
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr int target_size = 512;
+constexpr int head_count  = 8;
+
+using draw_info = swgl::command_buffer::draw_info;
+
+// Eight heads in a row, staggered in depth so they overlap on screen.
+std::vector<draw_info> make_heads() {
+  std::vector<draw_info> heads;
+  for(int i = 0; i < head_count; ++i) {
+    draw_info info   = swgl::test::make_draw_info(target_size, 3.f);
+    info.model[0][3] = -2.f + i * 0.5f;
+    info.model[2][3] = -(i % 3) * 0.7f;
+    heads.push_back(info);
+  }
+  return heads;
+}
+
+struct frame {
+  frame()
+      : colour(target_size, target_size, swgl::image::RGB)
+      , depth(target_size, target_size) {
+    colour.clear(swgl::image::colour_type(0, 0, 0, 255));
+    depth.clear();
+  }
+
+  swgl::image colour;
+  swgl::depth_buffer depth;
+};
+
+// The heads alternate between a gouraud and a phong shader, which every
+// frame shares.
+struct scene {
+  scene()
+      : model(swgl::test::load_model("african_head/african_head.obj"))
+      , diffuse(swgl::test::load_texture(
+            "african_head/african_head_diffuse.tga"))
+      , heads(make_heads()) {
+  }
+
+  void draw_immediately(frame& f) {
+    for(int i = 0; i < head_count; ++i) {
+      if(i % 2) {
+        draw_immediately(phong, f, heads[i]);
+      }
+      else {
+        draw_immediately(gouraud, f, heads[i]);
+      }
+    }
+  }
+
+  // Gouraud heads from one thread and phong heads from another, interleaved
+  // with each other.
+  void record(swgl::command_buffer& commands, frame& f) {
+    std::thread even([&] {
+      for(int i = 0; i < head_count; i += 2) {
+        commands.draw(gouraud, model, f.colour, f.depth, &diffuse, heads[i]);
+      }
+    });
+    std::thread odd([&] {
+      for(int i = 1; i < head_count; i += 2) {
+        commands.draw(phong, model, f.colour, f.depth, &diffuse, heads[i]);
+      }
+    });
+    even.join();
+    odd.join();
+  }
+
+  swgl::model const model;
+  swgl::image const diffuse;
+  std::vector<draw_info> const heads;
+  swgl::shaders::gouraud gouraud;
+  swgl::shaders::phong phong;
+
+ private:
+  template <typename Shader>
+  void draw_immediately(Shader& shader, frame& f, draw_info const& info) {
+    shader.set_model(model);
+    shader.set_render_target(f.colour);
+    shader.set_depth(f.depth);
+    shader.set_albedo(diffuse);
+    shader.draw(info);
+  }
+};
+
+void check_identical(frame const& expected, frame const& actual) {
+  std::size_t const pixels = std::size_t(target_size) * target_size;
+  BOOST_TEST(
+      std::memcmp(
+          expected.colour.data(), actual.colour.data(),
+          pixels * expected.colour.bytespp()) == 0);
+  BOOST_TEST(
+      std::memcmp(
+          expected.depth.data(), actual.depth.data(),
+          pixels * expected.depth.bytes_per_pixel()) == 0);
+}
+
+} // namespace
+
+// Sorted submission only reorders draws that interact through the depth
+// test, so the frame matches drawing the heads immediately in order.
+BOOST_AUTO_TEST_CASE(sorted_submit_matches_immediate) {
+  scene s;
+  frame immediate;
+  s.draw_immediately(immediate);
+
+  frame recorded;
+  swgl::command_buffer commands;
+  s.record(commands, recorded);
+  BOOST_TEST(commands.size() == std::size_t(head_count));
+  commands.submit();
+  BOOST_TEST(commands.size() == 0u);
+  check_identical(immediate, recorded);
+}
+
+// The next frame is recorded with the same shaders while this one is being
+// submitted. Whichever submit a command lands in, both frames come out
+// whole.
+BOOST_AUTO_TEST_CASE(record_during_submit) {
+  scene s;
+  frame immediate;
+  s.draw_immediately(immediate);
+
+  frame first;
+  frame second;
+  swgl::command_buffer commands;
+  s.record(commands, first);
+  std::thread next_frame([&] { s.record(commands, second); });
+  commands.submit();
+  next_frame.join();
+  commands.submit();
+  BOOST_TEST(commands.size() == 0u);
+
+  check_identical(immediate, first);
+  check_identical(immediate, second);
+}
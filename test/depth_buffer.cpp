@@ -0,0 +1,256 @@
+//
+// test/depth_buffer.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE depth_buffer
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
+#include "swgl/simd.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <sstream>
+
+namespace {
+
+using swgl::depth_format;
+
+constexpr int target_size = 64;
+constexpr float min_z     = 0.f;
+constexpr float max_z     = 255.f;
+constexpr float far       = -std::numeric_limits<float>::max();
+
+// Values spread over and past the depth range, at and between steps.
+float const z_values[] = {-1000.f, -1.f,   0.f,    1e-6f, 0.25f, 1.f,
+                          17.3f,   100.f,  127.5f, 200.f, 254.99f, 255.f,
+                          255.01f, 300.f,  1e6f,   63.1f};
+
+template <typename Encoding>
+void check_encoding(Encoding const& encoding) {
+  float const largest = Encoding::largest();
+  // A copy, as BOOST_TEST takes its operands by reference.
+  typename Encoding::value_type const cleared = Encoding::cleared;
+
+  // The ends of the range map to the ends of [1, 2^n - 1], and everything
+  // past them is clamped.
+  BOOST_TEST(float(encoding.encode(min_z)) == 1.f);
+  BOOST_TEST(float(encoding.encode(max_z)) == largest);
+  BOOST_TEST(float(encoding.encode(min_z - 10.f)) == 1.f);
+  BOOST_TEST(float(encoding.encode(-1e30f)) == 1.f);
+  BOOST_TEST(float(encoding.encode(max_z + 10.f)) == largest);
+  BOOST_TEST(float(encoding.encode(1e30f)) == largest);
+
+  for(float z : z_values) {
+    BOOST_TEST_CONTEXT("z " << z) {
+      auto const stored = encoding.encode(z);
+      // Anything drawn is nearer than a cleared pixel.
+      BOOST_TEST(stored > cleared);
+      BOOST_TEST(float(stored) >= 1.f);
+      BOOST_TEST(float(stored) <= largest);
+      // Decoding gives the bottom of the step z fell in, give or take the
+      // float rounding, which is as large as a unorm24 step near max_z.
+      if(z >= min_z && z <= max_z) {
+        float const step = (max_z - min_z) / (largest - 1.f);
+        float const back = encoding.decode(stored);
+        BOOST_TEST(back <= z + step);
+        BOOST_TEST(back >= z - 2.f * step);
+      }
+    }
+  }
+
+  // Nearer z never stores a smaller value, so the depth test agrees with
+  // the float one apart from ties within a step.
+  for(float a : z_values) {
+    for(float b : z_values) {
+      if(a < b) {
+        BOOST_TEST(encoding.encode(a) <= encoding.encode(b));
+      }
+    }
+  }
+  BOOST_TEST(encoding.encode(100.f) < encoding.encode(101.f));
+
+  BOOST_TEST(encoding.decode(cleared) == far);
+}
+
+// The vector encode gives the scalar's integers, as floats.
+template <typename Encoding>
+void check_vector_encoding(Encoding const& encoding) {
+  constexpr int width       = swgl::simd::float_v::width;
+  constexpr int value_count = sizeof(z_values) / sizeof(z_values[0]);
+  for(int first = 0; first + width <= value_count; first += width) {
+    float lanes[width];
+    encoding.encode(swgl::simd::float_v::load(&z_values[first]))
+        .store(lanes);
+    for(int i = 0; i < width; ++i) {
+      BOOST_TEST(lanes[i] == float(encoding.encode(z_values[first + i])));
+    }
+  }
+}
+
+template <typename T>
+bool all_zero(swgl::depth_buffer const& depth) {
+  T const* values = static_cast<T const*>(depth.data());
+  for(int i = 0; i < depth.width() * depth.height(); ++i) {
+    if(values[i] != 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Draws the model's positions as they are, in screen space, with the
+// first two faces red and the rest green.
+class solid : public swgl::pipeline<solid> {
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector3f position = swgl::vector3f::zero();
+    float green             = 0.f;
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position, &vertex_out::green);
+    }
+  };
+
+  friend class swgl::pipeline<solid>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    vertex_out out;
+    out.position = get_model().position(face, idx);
+    out.green    = face < 2 ? 0.f : 1.f;
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const& in) const {
+    return swgl::colour<float>(1.f - in.green, in.green, 0.f, 1.f);
+  }
+};
+
+// A red quad over [4, 40) at red_z, then a green one over [24, 60) at
+// green_z.
+swgl::model make_quads(float red_z, float green_z) {
+  std::ostringstream obj;
+  obj << "v 4 4 " << red_z << "\n"
+      << "v 40 4 " << red_z << "\n"
+      << "v 40 40 " << red_z << "\n"
+      << "v 4 40 " << red_z << "\n"
+      << "v 24 24 " << green_z << "\n"
+      << "v 60 24 " << green_z << "\n"
+      << "v 60 60 " << green_z << "\n"
+      << "v 24 60 " << green_z << "\n"
+      << "f 1 2 3\n"
+      << "f 1 3 4\n"
+      << "f 5 6 7\n"
+      << "f 5 7 8\n";
+  return swgl::test::model_from_obj(obj.str().c_str());
+}
+
+// Draws the quads and returns whether the overlap ended up green.
+bool green_wins(depth_format format, float red_z, float green_z) {
+  swgl::model const quads = make_quads(red_z, green_z);
+  swgl::image rt(target_size, target_size, swgl::image::RGB);
+  swgl::depth_buffer depth(target_size, target_size, format);
+  rt.clear(swgl::image::colour_type(0, 0, 0, 255));
+  depth.clear();
+
+  solid pipeline;
+  pipeline.set_model(quads);
+  pipeline.set_render_target(rt);
+  pipeline.set_depth(depth);
+  pipeline.set_cull_mode(swgl::cull_mode::none);
+  pipeline.draw();
+
+  // Outside the overlap each quad is drawn whatever its depth.
+  BOOST_TEST(int(rt.get(10, 10).r()) == 255);
+  BOOST_TEST(int(rt.get(50, 50).g()) == 255);
+  BOOST_TEST(depth.get(0, 0) == far);
+  BOOST_TEST(depth.get(30, 30) >= std::min(red_z, green_z) - 0.01f);
+  return rt.get(30, 30).g() != 0;
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(unorm24_encoding) {
+  swgl::depth_buffer depth(4, 4, depth_format::unorm24, min_z, max_z);
+  swgl::unorm24_depth const encoding(depth.scale(), depth.bias());
+  BOOST_TEST(swgl::unorm24_depth::largest() == float((1 << 24) - 1));
+  check_encoding(encoding);
+  check_vector_encoding(encoding);
+}
+
+BOOST_AUTO_TEST_CASE(unorm16_encoding) {
+  swgl::depth_buffer depth(4, 4, depth_format::unorm16, min_z, max_z);
+  swgl::unorm16_depth const encoding(depth.scale(), depth.bias());
+  BOOST_TEST(swgl::unorm16_depth::largest() == float((1 << 16) - 1));
+  check_encoding(encoding);
+  check_vector_encoding(encoding);
+}
+
+BOOST_AUTO_TEST_CASE(set_range_moves_the_encoding) {
+  swgl::depth_buffer depth(4, 4, depth_format::unorm16, min_z, max_z);
+  depth.set_range(-2.f, 2.f);
+  swgl::unorm16_depth const encoding(depth.scale(), depth.bias());
+  BOOST_TEST(float(encoding.encode(-2.f)) == 1.f);
+  BOOST_TEST(float(encoding.encode(2.f)) == swgl::unorm16_depth::largest());
+  BOOST_TEST(float(encoding.encode(100.f)) == swgl::unorm16_depth::largest());
+}
+
+BOOST_AUTO_TEST_CASE(clear_values) {
+  swgl::depth_buffer f32(20, 18, depth_format::float32);
+  swgl::depth_buffer u24(20, 18, depth_format::unorm24);
+  swgl::depth_buffer u16(20, 18, depth_format::unorm16);
+  BOOST_TEST(f32.bytes_per_pixel() == 4u);
+  BOOST_TEST(u24.bytes_per_pixel() == 4u);
+  BOOST_TEST(u16.bytes_per_pixel() == 2u);
+
+  float const* values = static_cast<float const*>(f32.data());
+  bool all_far        = true;
+  for(int i = 0; i < 20 * 18; ++i) {
+    all_far &= values[i] == far;
+  }
+  BOOST_TEST(all_far);
+  BOOST_TEST(all_zero<std::uint32_t>(u24));
+  BOOST_TEST(all_zero<std::uint16_t>(u16));
+
+  for(swgl::depth_buffer* depth : {&f32, &u24, &u16}) {
+    BOOST_TEST(depth->get(0, 0) == far);
+    BOOST_TEST(depth->get(19, 17) == far);
+    depth->fast_clear();
+    BOOST_TEST(depth->clear_pending());
+    BOOST_TEST(depth->get(7, 9) == far);
+    depth->resolve_clear();
+    BOOST_TEST(!depth->clear_pending());
+    BOOST_TEST(depth->get(7, 9) == far);
+  }
+}
+
+// Larger z is nearer, whichever quad is drawn first, in every format.
+BOOST_AUTO_TEST_CASE(nearer_wins_in_every_format) {
+  for(auto format : {depth_format::float32, depth_format::unorm24,
+                     depth_format::unorm16}) {
+    BOOST_TEST_CONTEXT("format " << int(format)) {
+      BOOST_TEST(green_wins(format, 100.f, 101.f));
+      BOOST_TEST(!green_wins(format, 101.f, 100.f));
+    }
+  }
+}
+
+// The test is strictly nearer, so z values that encode the same keep the
+// first quad drawn. A thousandth apart is within a unorm16 step but not a
+// unorm24 one.
+BOOST_AUTO_TEST_CASE(ties_keep_the_first_fragment) {
+  BOOST_TEST(green_wins(depth_format::float32, 100.2f, 100.201f));
+  BOOST_TEST(green_wins(depth_format::unorm24, 100.2f, 100.201f));
+  BOOST_TEST(!green_wins(depth_format::unorm16, 100.2f, 100.201f));
+  BOOST_TEST(!green_wins(depth_format::float32, 100.2f, 100.2f));
+}
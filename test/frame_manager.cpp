@@ -0,0 +1,200 @@
+//
+// test/frame_manager.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE frame_manager
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/frame_manager.hpp"
+#include "swgl/shaders/phong.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr int target_size = 128;
+
+swgl::image::colour_type const background(20, 40, 60, 255);
+
+// The head drawn with phong, on a target of any size, with the same camera
+// for every frame apart from how far the head is turned.
+struct scene {
+  scene()
+      : model(swgl::test::load_model("african_head/african_head.obj"))
+      , diffuse(swgl::test::load_texture(
+            "african_head/african_head_diffuse.tga")) {
+    shader.set_model(model);
+    shader.set_albedo(diffuse);
+  }
+
+  swgl::pipeline_counters draw(
+      swgl::image& colour, swgl::depth_buffer& depth, float turn) {
+    draw_info_ = swgl::test::make_draw_info(colour.width());
+    draw_info_.viewport =
+        swgl::viewport_matrix(0, 0, colour.width(), colour.height());
+    draw_info_.model[0][0] = std::cos(turn);
+    draw_info_.model[0][2] = std::sin(turn);
+    draw_info_.model[2][0] = -std::sin(turn);
+    draw_info_.model[2][2] = std::cos(turn);
+    shader.set_render_target(colour);
+    shader.set_depth(depth);
+    return shader.draw(draw_info_);
+  }
+
+  swgl::frame_manager::render_function render(float turn) {
+    return [this, turn](swgl::frame_manager::frame& f) {
+      return draw(f.colour, f.depth, turn);
+    };
+  }
+
+  swgl::model const model;
+  swgl::image const diffuse;
+  swgl::shaders::phong shader;
+
+ private:
+  swgl::shaders::basic_lighted_model::draw_info draw_info_;
+};
+
+struct reference {
+  reference(scene& s, int width, int height, float turn)
+      : colour(width, height, swgl::image::RGB)
+      , depth(width, height) {
+    colour.clear(background);
+    depth.clear();
+    s.draw(colour, depth, turn);
+  }
+
+  swgl::image colour;
+  swgl::depth_buffer depth;
+};
+
+void check_frame(
+    swgl::frame_manager::frame const& f, reference const& expected) {
+  BOOST_TEST(f.colour.width() == expected.colour.width());
+  BOOST_TEST(f.colour.height() == expected.colour.height());
+  BOOST_TEST(f.depth.width() == expected.colour.width());
+  BOOST_TEST(!f.colour.clear_pending());
+  if(f.colour.width() != expected.colour.width() ||
+     f.colour.height() != expected.colour.height()) {
+    return;
+  }
+
+  std::size_t const pixels =
+      std::size_t(f.colour.width()) * f.colour.height();
+  BOOST_TEST(
+      std::memcmp(
+          f.colour.data(), expected.colour.data(),
+          pixels * f.colour.bytespp()) == 0);
+  int depth_mismatches = 0;
+  for(int y = 0; y < f.colour.height(); ++y) {
+    for(int x = 0; x < f.colour.width(); ++x) {
+      depth_mismatches += f.depth.get(x, y) != expected.depth.get(x, y);
+    }
+  }
+  BOOST_TEST(depth_mismatches == 0);
+}
+
+float turn_of(int frame) {
+  return frame * 0.25f;
+}
+
+} // namespace
+
+// Each frame is rendered one ahead of the one being read, and comes back
+// in order with the contents of a direct render. More frames than buffers
+// go round the ring several times.
+BOOST_AUTO_TEST_CASE(ring_round_trip) {
+  scene s;
+  constexpr int frame_count = 7;
+  std::vector<std::unique_ptr<reference>> expected;
+  for(int i = 0; i < frame_count; ++i) {
+    expected.emplace_back(
+        new reference(s, target_size, target_size, turn_of(i)));
+  }
+
+  swgl::frame_manager frames(target_size, target_size);
+  frames.set_clear_colour(background);
+  frames.submit(s.render(turn_of(0)));
+  std::uint64_t last_number = 0;
+  for(int i = 0; i < frame_count; ++i) {
+    if(i + 1 < frame_count) {
+      frames.submit(s.render(turn_of(i + 1)));
+    }
+    swgl::frame_manager::frame const* f = frames.acquire();
+    BOOST_TEST_REQUIRE(f != nullptr);
+    BOOST_TEST_CONTEXT("frame " << i) {
+      if(i > 0) {
+        BOOST_TEST(f->number == last_number + 1);
+      }
+      last_number = f->number;
+      check_frame(*f, *expected[i]);
+    }
+    frames.release();
+  }
+  BOOST_TEST(frames.acquire() == nullptr);
+}
+
+// Frames keep the size they were submitted with, and a resize and back
+// recreates the buffers as they come round.
+BOOST_AUTO_TEST_CASE(resize_round_trip) {
+  scene s;
+  reference const square(s, target_size, target_size, 0.f);
+  reference const wide(s, target_size + 32, target_size / 2, 0.f);
+
+  swgl::frame_manager frames(target_size, target_size);
+  frames.set_clear_colour(background);
+  frames.submit(s.render(0.f));
+  frames.resize(target_size + 32, target_size / 2);
+  BOOST_TEST(frames.width() == target_size + 32);
+  BOOST_TEST(frames.height() == target_size / 2);
+  frames.submit(s.render(0.f));
+
+  check_frame(*frames.acquire(), square);
+  frames.release();
+  frames.resize(target_size, target_size);
+  frames.submit(s.render(0.f));
+  check_frame(*frames.acquire(), wide);
+  frames.release();
+  check_frame(*frames.acquire(), square);
+  frames.release();
+}
+
+BOOST_AUTO_TEST_CASE(depth_format_follows_submit) {
+  scene s;
+  swgl::frame_manager frames(target_size, target_size);
+  frames.submit(s.render(0.f));
+  frames.set_depth_format(swgl::depth_format::unorm16);
+  frames.submit(s.render(0.f));
+  BOOST_TEST(
+      (frames.acquire()->depth.format() == swgl::depth_format::float32));
+  frames.release();
+  BOOST_TEST(
+      (frames.acquire()->depth.format() == swgl::depth_format::unorm16));
+  frames.release();
+}
+
+// A render function that throws fails its own frame, and the next one is
+// unaffected.
+BOOST_AUTO_TEST_CASE(render_error_rethrown_from_acquire) {
+  scene s;
+  reference const expected(s, target_size, target_size, 0.f);
+  swgl::frame_manager frames(target_size, target_size);
+  frames.set_clear_colour(background);
+  frames.submit([](swgl::frame_manager::frame&) -> swgl::pipeline_counters {
+    throw std::runtime_error("render failed");
+  });
+  frames.submit(s.render(0.f));
+  BOOST_CHECK_THROW(frames.acquire(), std::runtime_error);
+  check_frame(*frames.acquire(), expected);
+  frames.release();
+}
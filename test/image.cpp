@@ -0,0 +1,92 @@
+//
+// test/image.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE image
+#include <boost/test/unit_test.hpp>
+
+#include "swgl/colour.hpp"
+#include "swgl/image.hpp"
+
+namespace {
+
+using colour_type = swgl::image::colour_type;
+
+void check_rgb(colour_type const& c, colour_type const& expected) {
+  BOOST_TEST(int(c.r()) == int(expected.r()));
+  BOOST_TEST(int(c.g()) == int(expected.g()));
+  BOOST_TEST(int(c.b()) == int(expected.b()));
+}
+
+void check_pixel(swgl::image const& img, int x, int y, colour_type const& c) {
+  check_rgb(img.get(x, y), c);
+  unsigned char const* p = img.data() + (y * img.width() + x) * img.bytespp();
+  BOOST_TEST(int(p[0]) == int(c.r()));
+  BOOST_TEST(int(p[1]) == int(c.g()));
+  BOOST_TEST(int(p[2]) == int(c.b()));
+}
+
+colour_type const clear_colour(10, 20, 30, 255);
+colour_type const red(255, 0, 0, 255);
+colour_type const green(0, 255, 0, 255);
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(fast_clear_reads_back_clear_colour) {
+  swgl::image img(40, 24, swgl::image::RGB);
+  img.clear(red);
+  img.fast_clear(clear_colour);
+  BOOST_TEST(img.clear_pending());
+  check_rgb(img.get(0, 0), clear_colour);
+  check_rgb(img.get(39, 23), clear_colour);
+
+  img.resolve_clear();
+  BOOST_TEST(!img.clear_pending());
+  check_pixel(img, 0, 0, clear_colour);
+  check_pixel(img, 39, 23, clear_colour);
+}
+
+BOOST_AUTO_TEST_CASE(set_after_fast_clear) {
+  swgl::image img(40, 24, swgl::image::RGB);
+  img.clear(red);
+  img.fast_clear(clear_colour);
+
+  // The written pixel and its tile neighbour both read back correctly
+  // before the rest of the image is resolved.
+  img.resolve_clear(5, 6, 5, 6);
+  img.set(5, 6, green);
+  check_rgb(img.get(5, 6), green);
+  check_rgb(img.get(4, 6), clear_colour);
+  check_rgb(img.get(20, 20), clear_colour);
+  BOOST_TEST(img.clear_pending());
+
+  // Resolving the remaining tiles must not overwrite the write.
+  img.resolve_clear();
+  check_pixel(img, 5, 6, green);
+  check_pixel(img, 4, 6, clear_colour);
+  check_pixel(img, 20, 20, clear_colour);
+}
+
+BOOST_AUTO_TEST_CASE(set_after_fast_clear_survives_rect_resolve) {
+  swgl::image img(40, 24, swgl::image::RGB);
+  img.fast_clear(clear_colour);
+  img.resolve_clear(33, 17, 33, 17);
+  img.set(33, 17, green);
+  img.resolve_clear(32, 16, 39, 23);
+  img.resolve_clear();
+  check_pixel(img, 33, 17, green);
+  check_pixel(img, 32, 16, clear_colour);
+}
+
+BOOST_AUTO_TEST_CASE(discard_clear_keeps_written_pixels) {
+  swgl::image img(40, 24, swgl::image::RGB);
+  img.clear(red);
+  img.fast_clear(clear_colour);
+  img.discard_clear();
+  BOOST_TEST(!img.clear_pending());
+  check_pixel(img, 0, 0, red);
+}
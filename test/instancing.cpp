@@ -0,0 +1,130 @@
+//
+// test/instancing.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE instancing
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/shaders/gouraud.hpp"
+#include "swgl/thread_pool.hpp"
+
+#include <cstring>
+#include <vector>
+
+namespace {
+
+constexpr int target_size = 256;
+
+using draw_info = swgl::shaders::basic_lighted_model::draw_info;
+
+swgl::matrix4f translation(float x, float z) {
+  swgl::matrix4f m = swgl::matrix4f::identity();
+  m[0][3]          = x;
+  m[2][3]          = z;
+  return m;
+}
+
+// Five overlapping heads in view and three far off to the side, which
+// should be culled whole.
+std::vector<swgl::matrix4f> make_instances() {
+  return {
+      translation(-0.6f, -0.4f), translation(40.f, 0.f),
+      translation(-0.3f, 0.f),   translation(0.f, -0.8f),
+      translation(-40.f, 0.f),   translation(0.3f, -0.2f),
+      translation(0.6f, -0.6f),  translation(0.f, 60.f)};
+}
+
+constexpr int culled_instance_count = 3;
+
+struct frame {
+  frame()
+      : colour(target_size, target_size, swgl::image::RGB)
+      , depth(target_size, target_size) {
+    colour.clear(swgl::image::colour_type(0, 0, 0, 255));
+    depth.clear();
+  }
+
+  swgl::image colour;
+  swgl::depth_buffer depth;
+};
+
+void check_instancing(swgl::thread_pool* pool) {
+  swgl::model const model =
+      swgl::test::load_model("african_head/african_head.obj");
+  swgl::image const diffuse =
+      swgl::test::load_texture("african_head/african_head_diffuse.tga");
+  std::vector<swgl::matrix4f> const instances = make_instances();
+  draw_info const info = swgl::test::make_draw_info(target_size, 3.f);
+
+  swgl::shaders::gouraud shader;
+  shader.set_model(model);
+  shader.set_albedo(diffuse);
+  if(pool) {
+    shader.set_thread_pool(pool);
+  }
+
+  frame separate;
+  shader.set_render_target(separate.colour);
+  shader.set_depth(separate.depth);
+  swgl::pipeline_counters expected;
+  for(auto const& transform : instances) {
+    draw_info instance = info;
+    instance.model     = transform * info.model;
+    expected += shader.draw(instance);
+  }
+
+  frame instanced;
+  shader.set_render_target(instanced.colour);
+  shader.set_depth(instanced.depth);
+  swgl::pipeline_counters const actual =
+      shader.draw_instanced(info, instances);
+
+  std::size_t const pixels = std::size_t(target_size) * target_size;
+  BOOST_TEST(
+      std::memcmp(
+          separate.colour.data(), instanced.colour.data(),
+          pixels * separate.colour.bytespp()) == 0);
+  BOOST_TEST(
+      std::memcmp(
+          separate.depth.data(), instanced.depth.data(),
+          pixels * separate.depth.bytes_per_pixel()) == 0);
+
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+  BOOST_TEST(actual.culled_draw_count() == culled_instance_count);
+  BOOST_TEST(actual.culled_draw_count() == expected.culled_draw_count());
+  BOOST_TEST(actual.draw_count() == expected.draw_count());
+  BOOST_TEST(actual.triangle_count() == expected.triangle_count());
+  BOOST_TEST(actual.vertex_shader_count() == expected.vertex_shader_count());
+  BOOST_TEST(actual.pixel_count() == expected.pixel_count());
+  BOOST_TEST(
+      actual.fragment_shader_count() == expected.fragment_shader_count());
+  BOOST_TEST(
+      actual.facing_culled_triangle_count() ==
+      expected.facing_culled_triangle_count());
+  BOOST_TEST(actual.pixel_count() > 0);
+#else
+  (void)actual;
+  (void)expected;
+#endif
+}
+
+} // namespace
+
+// Drawing the instances in one call matches drawing each transform on its
+// own: the same image, the same off-screen instances culled whole, and
+// counters that add up to the separate draws'.
+BOOST_AUTO_TEST_CASE(instanced_matches_separate_draws) {
+  check_instancing(nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(instanced_matches_separate_draws_tiled) {
+  swgl::thread_pool pool(4);
+  check_instancing(&pool);
+}
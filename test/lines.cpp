@@ -0,0 +1,258 @@
+//
+// test/lines.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE lines
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
+#include "swgl/thread_pool.hpp"
+
+#include <atomic>
+
+namespace {
+
+constexpr int target_size = 64;
+
+// Draws the model's positions as they are, in screen space, in one colour,
+// counting the fragments it shades.
+class screen : public swgl::pipeline<screen> {
+ public:
+  int fragment_count() const {
+    return fragments_;
+  }
+
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector3f position = swgl::vector3f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<screen>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    vertex_out out;
+    out.position = get_model().position(face, idx);
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    ++fragments_;
+    return swgl::colour<float>(1.f, 1.f, 1.f, 1.f);
+  }
+
+  mutable std::atomic<int> fragments_{0};
+};
+
+// Model positions are taken as homogeneous (x, y, w), already in the
+// viewport's space, so a line can put an end behind the eye.
+class homogeneous : public swgl::pipeline<homogeneous> {
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector4f position = swgl::vector4f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<homogeneous>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    swgl::vector3f const p = get_model().position(face, idx);
+    vertex_out out;
+    out.position = swgl::vector4f(p.x, p.y, 1.f, p.z);
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    return swgl::colour<float>(1.f, 1.f, 1.f, 1.f);
+  }
+};
+
+// A right angled triangle whose edges are horizontal, vertical and at 45
+// degrees, so every line steps through whole pixels with no rounding, 33
+// pixels each with the corners shared.
+char const* const right_triangle =
+    "v 4 4 1\n"
+    "v 36 4 1\n"
+    "v 4 36 1\n"
+    "f 1 2 3\n";
+
+// A single line with a slope of a third, drawn there and back by a face
+// whose last two corners are the same. No step lands halfway between two
+// rows, so both directions pick the same pixels.
+char const* const shallow_line =
+    "v 4 10 1\n"
+    "v 40 22 1\n"
+    "f 1 2 2\n";
+
+// A line from (8, 16.25) at w = 1 to a point behind the eye at w = -1. The
+// part in front of the eye runs right along y = 16.25, away from where
+// dividing the far end by its w would put it, (-56, 16.25).
+char const* const crossing_line =
+    "v 8 16.25 1\n"
+    "v 56 -16.25 -1\n"
+    "f 1 2 2\n";
+
+struct target {
+  target()
+      : rt(target_size, target_size, swgl::image::RGB)
+      , depth(target_size, target_size) {
+    rt.clear(swgl::image::colour_type(0, 0, 0, 255));
+    depth.clear();
+  }
+
+  swgl::image rt;
+  swgl::depth_buffer depth;
+};
+
+template <typename Pipeline>
+swgl::pipeline_counters draw(
+    target& t,
+    Pipeline& pipeline,
+    swgl::model const& m,
+    swgl::primitive_topology topology,
+    swgl::raster_mode mode,
+    swgl::thread_pool* pool) {
+  pipeline.set_model(m);
+  pipeline.set_render_target(t.rt);
+  pipeline.set_depth(t.depth);
+  pipeline.set_cull_mode(swgl::cull_mode::none);
+  pipeline.set_topology(topology);
+  pipeline.set_raster_mode(mode);
+  if(pool) {
+    pipeline.set_thread_pool(pool);
+    pipeline.set_tile_size(16);
+  }
+  return pipeline.draw();
+}
+
+// The number of pixels set where expected(x, y) is false, or not set where
+// it is true.
+template <typename ExpectedFn>
+int count_wrong_pixels(swgl::image const& rt, ExpectedFn const& expected) {
+  int count = 0;
+  for(int y = 0; y < rt.height(); ++y) {
+    for(int x = 0; x < rt.width(); ++x) {
+      count += (rt.get(x, y).r() != 0) != expected(x, y);
+    }
+  }
+  return count;
+}
+
+// Runs check in both raster modes, serially and tiled.
+template <typename CheckFn>
+void for_each_mode(CheckFn const& check) {
+  swgl::thread_pool pool(4);
+  for(auto mode :
+      {swgl::raster_mode::floating_point, swgl::raster_mode::fixed_point}) {
+    for(swgl::thread_pool* p : {static_cast<swgl::thread_pool*>(nullptr),
+                                &pool}) {
+      BOOST_TEST_CONTEXT(
+          "raster mode " << int(mode) << " tiled " << (p != nullptr)) {
+        check(mode, p);
+      }
+    }
+  }
+}
+
+} // namespace
+
+// Each pixel of the outline is shaded once: the second line through a
+// shared corner fails the depth test against the first.
+BOOST_AUTO_TEST_CASE(triangle_outline) {
+  swgl::model const m = swgl::test::model_from_obj(right_triangle);
+  for_each_mode([&](swgl::raster_mode mode, swgl::thread_pool* pool) {
+    target t;
+    screen pipeline;
+    swgl::pipeline_counters const counters = draw(
+        t, pipeline, m, swgl::primitive_topology::line_list, mode, pool);
+    int const wrong = count_wrong_pixels(t.rt, [](int x, int y) {
+      bool const horizontal = y == 4 && x >= 4 && x <= 36;
+      bool const vertical   = x == 4 && y >= 4 && y <= 36;
+      bool const diagonal   = x + y == 40 && x >= 4 && y >= 4;
+      return horizontal || vertical || diagonal;
+    });
+    BOOST_TEST(wrong == 0);
+    BOOST_TEST(pipeline.fragment_count() == 3 * 33 - 3);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+    BOOST_TEST(counters.line_count() == 3);
+#else
+    (void)counters;
+#endif
+  });
+}
+
+// Both ends are drawn, and each column between them has one pixel, in the
+// row nearest the line.
+BOOST_AUTO_TEST_CASE(shallow_line_pixels_and_ends) {
+  swgl::model const m = swgl::test::model_from_obj(shallow_line);
+  for_each_mode([&](swgl::raster_mode mode, swgl::thread_pool* pool) {
+    target t;
+    screen pipeline;
+    draw(t, pipeline, m, swgl::primitive_topology::line_list, mode, pool);
+    int const wrong = count_wrong_pixels(t.rt, [](int x, int y) {
+      int const i = x - 4;
+      return i >= 0 && i <= 36 && y == 10 + (i + 1) / 3;
+    });
+    BOOST_TEST(wrong == 0);
+    BOOST_TEST(t.rt.get(4, 10).r() != 0);
+    BOOST_TEST(t.rt.get(40, 22).r() != 0);
+    BOOST_TEST(pipeline.fragment_count() == 37);
+  });
+}
+
+BOOST_AUTO_TEST_CASE(points_are_single_pixels) {
+  swgl::model const m = swgl::test::model_from_obj(right_triangle);
+  for_each_mode([&](swgl::raster_mode mode, swgl::thread_pool* pool) {
+    target t;
+    screen pipeline;
+    swgl::pipeline_counters const counters = draw(
+        t, pipeline, m, swgl::primitive_topology::point_list, mode, pool);
+    int const wrong = count_wrong_pixels(t.rt, [](int x, int y) {
+      return (x == 4 && y == 4) || (x == 36 && y == 4) ||
+             (x == 4 && y == 36);
+    });
+    BOOST_TEST(wrong == 0);
+    BOOST_TEST(pipeline.fragment_count() == 3);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+    BOOST_TEST(counters.point_count() == 3);
+#else
+    (void)counters;
+#endif
+  });
+}
+
+// The line is cut where it crosses the near plane, and what is left runs
+// from its front end to the right edge of the target. The point at the far
+// end is behind the eye and dropped.
+BOOST_AUTO_TEST_CASE(line_clipped_at_near_plane) {
+  swgl::model const m = swgl::test::model_from_obj(crossing_line);
+  for_each_mode([&](swgl::raster_mode mode, swgl::thread_pool* pool) {
+    target t;
+    homogeneous pipeline;
+    swgl::pipeline_counters const counters = draw(
+        t, pipeline, m, swgl::primitive_topology::line_list, mode, pool);
+    int const wrong = count_wrong_pixels(
+        t.rt, [](int x, int y) { return y == 16 && x >= 8; });
+    BOOST_TEST(wrong == 0);
+#if SWGL_ENABLE_PIPELINE_COUNTERS
+    BOOST_TEST(counters.line_count() == 2);
+#else
+    (void)counters;
+#endif
+  });
+}
@@ -0,0 +1,127 @@
+//
+// test/raster.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE raster
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
+#include "swgl/thread_pool.hpp"
+
+#include <atomic>
+#include <sstream>
+
+namespace {
+
+constexpr int target_size = 64;
+
+// Draws the model's positions as they are, in screen space, in one colour,
+// counting the fragments it shades. Each face is nearer than the one
+// before, so a pixel covered by two faces passes the depth test twice and
+// is counted twice.
+class solid : public swgl::pipeline<solid> {
+ public:
+  int fragment_count() const {
+    return fragments_;
+  }
+
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector3f position = swgl::vector3f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<solid>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    vertex_out out;
+    out.position   = get_model().position(face, idx);
+    out.position.z = static_cast<float>(face + 1);
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    ++fragments_;
+    return swgl::colour<float>(1.f, 1.f, 1.f, 1.f);
+  }
+
+  mutable std::atomic<int> fragments_{0};
+};
+
+// The quad from (lo, lo) to (hi, hi) as two triangles sharing the diagonal.
+swgl::model make_quad(float lo, float hi) {
+  std::ostringstream obj;
+  obj << "v " << lo << " " << lo << " 0\n"
+      << "v " << hi << " " << lo << " 0\n"
+      << "v " << hi << " " << hi << " 0\n"
+      << "v " << lo << " " << hi << " 0\n"
+      << "f 1 2 3\n"
+      << "f 1 3 4\n";
+  return swgl::test::model_from_obj(obj.str().c_str());
+}
+
+int count_set_pixels(swgl::image const& rt) {
+  int count = 0;
+  for(int y = 0; y < rt.height(); ++y) {
+    for(int x = 0; x < rt.width(); ++x) {
+      count += rt.get(x, y).r() != 0;
+    }
+  }
+  return count;
+}
+
+// Draws the quad and checks each pixel whose centre it covers is shaded
+// exactly once, including the ones the diagonal and the outer edges pass
+// through.
+void check_quad(float lo, float hi, int area, swgl::thread_pool* pool) {
+  swgl::model const quad = make_quad(lo, hi);
+  swgl::image rt(target_size, target_size, swgl::image::RGB);
+  swgl::depth_buffer depth(target_size, target_size);
+  rt.clear(swgl::image::colour_type(0, 0, 0, 255));
+  depth.clear();
+
+  solid pipeline;
+  pipeline.set_model(quad);
+  pipeline.set_render_target(rt);
+  pipeline.set_depth(depth);
+  pipeline.set_cull_mode(swgl::cull_mode::none);
+  pipeline.set_raster_mode(swgl::raster_mode::fixed_point);
+  if(pool) {
+    pipeline.set_thread_pool(pool);
+    pipeline.set_tile_size(16);
+  }
+
+  pipeline.draw();
+  BOOST_TEST(pipeline.fragment_count() == area);
+  BOOST_TEST(count_set_pixels(rt) == area);
+}
+
+} // namespace
+
+// Every edge, the shared diagonal included, runs through pixel centres, so
+// only the top-left rule decides which triangle owns them.
+BOOST_AUTO_TEST_CASE(fixed_point_quad_on_pixel_centres) {
+  check_quad(2.5f, 34.5f, 32 * 32, nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_point_quad_on_pixel_corners) {
+  check_quad(3.f, 40.f, 37 * 37, nullptr);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_point_quad_tiled) {
+  swgl::thread_pool pool(4);
+  check_quad(2.5f, 34.5f, 32 * 32, &pool);
+  check_quad(3.f, 40.f, 37 * 37, &pool);
+}
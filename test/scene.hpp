@@ -0,0 +1,81 @@
+//
+// test/scene.hpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#ifndef SWGL_TEST_SCENE_HPP
+#define SWGL_TEST_SCENE_HPP
+#pragma once
+
+#include "swgl/camera.hpp"
+#include "swgl/image.hpp"
+#include "swgl/model.hpp"
+#include "swgl/shaders/basic_lighted_model.hpp"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// Set by the build to the repository's assets directory.
+#ifndef SWGL_ASSETS_DIR
+#  define SWGL_ASSETS_DIR "assets"
+#endif
+
+namespace swgl { namespace test {
+
+inline std::string asset_path(char const* name) {
+  return std::string(SWGL_ASSETS_DIR) + "/" + name;
+}
+
+inline model load_model(char const* name) {
+  std::ifstream in(asset_path(name));
+  if(!in.is_open()) {
+    throw std::runtime_error("can't open asset " + asset_path(name));
+  }
+  return model(in);
+}
+
+inline image load_texture(char const* name) {
+  image texture;
+  if(!texture.read_tga_file(asset_path(name).c_str())) {
+    throw std::runtime_error("can't read texture " + asset_path(name));
+  }
+  texture.flip_vertically();
+  return texture;
+}
+
+// A model from obj text, for scenes of a few hand placed triangles.
+inline model model_from_obj(char const* obj) {
+  std::istringstream in(obj);
+  return model(in);
+}
+
+// The example's starting view of the model on a size x size target, from
+// radius away.
+inline shaders::basic_lighted_model::draw_info make_draw_info(
+    int size, float radius = 1.5f) {
+  shaders::basic_lighted_model::draw_info info;
+  info.eye = vector3f(0.3f, 0.2f, radius);
+
+  info.projection       = matrix4f::identity();
+  info.projection[3][2] = -1.f / radius;
+
+  info.view = lookat(info.eye, vector3f::zero(), vector3f(0.f, 1.f, 0.f));
+  info.view.set_column(3, info.view.get_column(3) * radius);
+
+  info.viewport = viewport_matrix(0, 0, size, size);
+  info.model    = matrix4f::identity();
+
+  info.directional_light = vector3f(0.f, 0.f, 1.f);
+  info.point_light       = vector3f(0.5f, 0.5f, 1.f);
+  info.ambient_light     = 0.2f;
+  return info;
+}
+
+}} // namespace swgl::test
+
+#endif // SWGL_TEST_SCENE_HPP
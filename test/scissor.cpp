@@ -0,0 +1,205 @@
+//
+// test/scissor.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE scissor
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/image.hpp"
+#include "swgl/pipeline.hpp"
+#include "swgl/shade_vertex_result.hpp"
+#include "swgl/thread_pool.hpp"
+
+#include <limits>
+#include <sstream>
+
+namespace {
+
+constexpr int target_size = 64;
+
+swgl::image::colour_type const background(10, 20, 30, 255);
+
+// Draws the model's positions as they are, in screen space, in white.
+class solid : public swgl::pipeline<solid> {
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector3f position = swgl::vector3f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<solid>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    vertex_out out;
+    out.position = get_model().position(face, idx);
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    return swgl::colour<float>(1.f, 1.f, 1.f, 1.f);
+  }
+};
+
+// The same, with the positions scaled by w = 2 before the divide, so setup
+// has to offset them by the viewport's corner scaled by w too.
+class homogeneous : public swgl::pipeline<homogeneous> {
+ private:
+  struct vertex_out : swgl::shade_vertex_result<vertex_out> {
+    swgl::vector4f position = swgl::vector4f::zero();
+
+    static auto attributes() {
+      return std::make_tuple(&vertex_out::position);
+    }
+  };
+
+  friend class swgl::pipeline<homogeneous>;
+
+  vertex_out shade_vertex(std::size_t face, std::size_t idx) const {
+    swgl::vector3f const p = get_model().position(face, idx);
+    vertex_out out;
+    out.position = swgl::vector4f(p.x * 2.f, p.y * 2.f, p.z * 2.f, 2.f);
+    return out;
+  }
+
+  swgl::colour<float> shade_fragment(vertex_out const&) const {
+    return swgl::colour<float>(1.f, 1.f, 1.f, 1.f);
+  }
+};
+
+// The quad from (lo_x, lo_y) to (hi_x, hi_y) as two triangles.
+swgl::model make_quad(float lo_x, float lo_y, float hi_x, float hi_y) {
+  std::ostringstream obj;
+  obj << "v " << lo_x << " " << lo_y << " 1\n"
+      << "v " << hi_x << " " << lo_y << " 1\n"
+      << "v " << hi_x << " " << hi_y << " 1\n"
+      << "v " << lo_x << " " << hi_y << " 1\n"
+      << "f 1 2 3\n"
+      << "f 1 3 4\n";
+  return swgl::test::model_from_obj(obj.str().c_str());
+}
+
+struct frame {
+  frame()
+      : colour(target_size, target_size, swgl::image::RGB)
+      , depth(target_size, target_size) {
+    colour.clear(background);
+    depth.clear();
+  }
+
+  swgl::image colour;
+  swgl::depth_buffer depth;
+};
+
+bool inside(swgl::screen_rect const& r, int x, int y) {
+  return x >= r.x && x < r.x + r.width && y >= r.y && y < r.y + r.height;
+}
+
+// Every pixel in expected is drawn, and every one outside it is left as it
+// was, colour and depth.
+void check_drawn(frame const& f, swgl::screen_rect const& expected) {
+  float const far   = -std::numeric_limits<float>::max();
+  int wrong_inside  = 0;
+  int wrong_outside = 0;
+  for(int y = 0; y < target_size; ++y) {
+    for(int x = 0; x < target_size; ++x) {
+      auto const c = f.colour.get(x, y);
+      if(inside(expected, x, y)) {
+        wrong_inside += c.r() != 255 || f.depth.get(x, y) == far;
+      }
+      else {
+        wrong_outside += c.r() != background.r() ||
+                         c.g() != background.g() ||
+                         c.b() != background.b() ||
+                         f.depth.get(x, y) != far;
+      }
+    }
+  }
+  BOOST_TEST(wrong_inside == 0);
+  BOOST_TEST(wrong_outside == 0);
+}
+
+// Draws the quad with the given rects in every raster mode, on one thread
+// and tiled, and checks it covers exactly expected.
+template <typename Pipeline = solid>
+void check_quad(
+    swgl::model const& quad,
+    swgl::screen_rect const* scissor,
+    swgl::screen_rect const* viewport,
+    swgl::screen_rect const& expected) {
+  swgl::thread_pool pool(4);
+  for(auto mode :
+      {swgl::raster_mode::floating_point, swgl::raster_mode::fixed_point}) {
+    for(swgl::thread_pool* p : {static_cast<swgl::thread_pool*>(nullptr),
+                                &pool}) {
+      BOOST_TEST_CONTEXT(
+          "raster mode " << int(mode) << " tiled " << (p != nullptr)) {
+        frame f;
+        Pipeline pipeline;
+        pipeline.set_model(quad);
+        pipeline.set_render_target(f.colour);
+        pipeline.set_depth(f.depth);
+        pipeline.set_cull_mode(swgl::cull_mode::none);
+        pipeline.set_raster_mode(mode);
+        if(p) {
+          pipeline.set_thread_pool(p);
+          pipeline.set_tile_size(16);
+        }
+        if(scissor) {
+          pipeline.set_scissor(*scissor);
+        }
+        if(viewport) {
+          pipeline.set_viewport(*viewport);
+        }
+        pipeline.draw();
+        check_drawn(f, expected);
+      }
+    }
+  }
+}
+
+} // namespace
+
+// A quad over the whole target only reaches the scissor rect, which is
+// placed off the tile grid so spans start and end mid tile.
+BOOST_AUTO_TEST_CASE(scissor_leaves_the_rest_untouched) {
+  swgl::model const quad          = make_quad(0.f, 0.f, 64.f, 64.f);
+  swgl::screen_rect const scissor = {10, 21, 17, 9};
+  check_quad(quad, &scissor, nullptr, scissor);
+}
+
+BOOST_AUTO_TEST_CASE(scissor_past_the_target_is_cut) {
+  swgl::model const quad          = make_quad(0.f, 0.f, 64.f, 64.f);
+  swgl::screen_rect const scissor = {50, -5, 40, 20};
+  check_quad(quad, &scissor, nullptr, {50, 0, 14, 15});
+}
+
+// Positions are relative to the viewport's corner, and the part of the quad
+// hanging over its far edges is cut off.
+BOOST_AUTO_TEST_CASE(viewport_offsets_and_cuts) {
+  swgl::model const quad           = make_quad(8.f, 4.f, 48.f, 40.f);
+  swgl::screen_rect const viewport = {20, 30, 32, 16};
+  check_quad(quad, nullptr, &viewport, {28, 34, 24, 12});
+}
+
+BOOST_AUTO_TEST_CASE(scissor_narrows_the_viewport) {
+  swgl::model const quad           = make_quad(8.f, 4.f, 48.f, 40.f);
+  swgl::screen_rect const viewport = {20, 30, 32, 16};
+  swgl::screen_rect const scissor  = {0, 0, 40, 40};
+  check_quad(quad, &scissor, &viewport, {28, 34, 12, 6});
+}
+
+BOOST_AUTO_TEST_CASE(viewport_offsets_homogeneous_positions) {
+  swgl::model const quad           = make_quad(8.f, 4.f, 48.f, 40.f);
+  swgl::screen_rect const viewport = {20, 30, 32, 16};
+  check_quad<homogeneous>(quad, nullptr, &viewport, {28, 34, 24, 12});
+}
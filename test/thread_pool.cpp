@@ -0,0 +1,79 @@
+//
+// test/thread_pool.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+#define BOOST_TEST_MODULE thread_pool
+#include <boost/test/unit_test.hpp>
+
+#include "swgl/thread_pool.hpp"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t job_count = 1000;
+
+// Every index runs exactly once, on a valid worker. Boost.Test isn't
+// thread safe, so the jobs only record what happened.
+void check_runs_every_index(swgl::thread_pool& pool) {
+  std::vector<std::atomic<int>> runs(job_count);
+  for(auto& r : runs) {
+    r = 0;
+  }
+  std::atomic<int> bad_workers{0};
+  pool.parallel_for(job_count, [&](std::size_t worker, std::size_t i) {
+    bad_workers += worker >= pool.size();
+    ++runs[i];
+  });
+  BOOST_TEST(bad_workers == 0);
+  for(auto const& r : runs) {
+    BOOST_TEST(r == 1);
+  }
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(runs_every_index) {
+  for(std::size_t workers : {1, 2, 4}) {
+    swgl::thread_pool pool(workers);
+    check_runs_every_index(pool);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(rethrows_a_job_exception) {
+  swgl::thread_pool pool(4);
+  BOOST_CHECK_THROW(
+      pool.parallel_for(
+          job_count,
+          [](std::size_t, std::size_t i) {
+            if(i == 5) {
+              throw std::runtime_error("job failed");
+            }
+          }),
+      std::runtime_error);
+
+  // The pool is still usable afterwards.
+  check_runs_every_index(pool);
+}
+
+// Every worker throws, the calling thread included, and only one
+// exception comes out.
+BOOST_AUTO_TEST_CASE(rethrows_when_every_job_throws) {
+  swgl::thread_pool pool(4);
+  for(int repeat = 0; repeat < 20; ++repeat) {
+    BOOST_CHECK_THROW(
+        pool.parallel_for(
+            job_count,
+            [](std::size_t, std::size_t) {
+              throw std::runtime_error("job failed");
+            }),
+        std::runtime_error);
+  }
+  check_runs_every_index(pool);
+}
@@ -0,0 +1,192 @@
+//
+// test/tiled.cpp
+//
+// Copyright (c) Chris Glover, 2018
+//
+// Distributed under the Boost Software License, Version 1.0. (See accompanying
+// file LICENSE_1_0.txt or copy at http://www.boost.org/LICENSE_1_0.txt)
+//
+// Renders the same scene serially and through a thread_pool and checks the
+// colour and depth are bit-identical, for each of the modes that promise it.
+//
+#define BOOST_TEST_MODULE tiled
+#include <boost/test/unit_test.hpp>
+
+#include "scene.hpp"
+
+#include "swgl/depth_buffer.hpp"
+#include "swgl/multisample_target.hpp"
+#include "swgl/shaders/gouraud.hpp"
+#include "swgl/shaders/phong.hpp"
+#include "swgl/thread_pool.hpp"
+
+#include <cstring>
+
+namespace {
+
+constexpr int target_size = 256;
+
+struct settings {
+  swgl::raster_mode raster   = swgl::raster_mode::floating_point;
+  swgl::shading_mode shading = swgl::shading_mode::forward;
+  swgl::shading_rate rate    = swgl::shading_rate::full;
+  bool hierarchical_depth    = false;
+  bool fast_clear            = false;
+  bool multisample           = false;
+};
+
+struct frame {
+  frame()
+      : colour(target_size, target_size, swgl::image::RGB)
+      , depth(target_size, target_size)
+      , samples(target_size, target_size) {
+  }
+
+  swgl::image colour;
+  swgl::depth_buffer depth;
+  swgl::multisample_target samples;
+};
+
+struct assets {
+  assets()
+      : model(swgl::test::load_model("african_head/african_head.obj"))
+      , diffuse(swgl::test::load_texture(
+            "african_head/african_head_diffuse.tga")) {
+  }
+
+  swgl::model model;
+  swgl::image diffuse;
+};
+
+assets const& get_assets() {
+  static assets const a;
+  return a;
+}
+
+// Two overlapping heads, the second partly behind the first, so the depth
+// test and the hierarchical depth both have something to reject.
+template <typename Shader>
+void render(frame& f, settings const& s, swgl::thread_pool* pool, int tile) {
+  swgl::image::colour_type const background(0, 0, 0, 255);
+  if(s.fast_clear) {
+    f.colour.clear(swgl::image::colour_type(255, 0, 255, 255));
+    f.colour.fast_clear(background);
+    f.depth.fast_clear();
+  }
+  else {
+    f.colour.clear(background);
+    f.depth.clear();
+  }
+  f.samples.clear(background);
+
+  Shader shader;
+  shader.set_model(get_assets().model);
+  shader.set_albedo(get_assets().diffuse);
+  shader.set_render_target(f.colour);
+  shader.set_depth(f.depth);
+  shader.set_raster_mode(s.raster);
+  shader.set_shading_mode(s.shading);
+  shader.set_shading_rate(s.rate);
+  shader.set_hierarchical_depth(s.hierarchical_depth);
+  if(s.multisample) {
+    shader.set_multisample_target(&f.samples);
+  }
+  if(pool) {
+    shader.set_thread_pool(pool);
+    shader.set_tile_size(tile);
+  }
+
+  auto info = swgl::test::make_draw_info(target_size);
+  shader.draw(info);
+  info.model[0][3] = 0.4f;
+  info.model[2][3] = -0.3f;
+  shader.draw(info);
+
+  if(s.multisample) {
+    f.samples.resolve(f.colour);
+  }
+  f.colour.resolve_clear();
+  f.depth.resolve_clear();
+}
+
+void check_identical(frame const& serial, frame const& tiled) {
+  std::size_t const pixels = std::size_t(target_size) * target_size;
+  BOOST_TEST(
+      std::memcmp(
+          serial.colour.data(), tiled.colour.data(),
+          pixels * serial.colour.bytespp()) == 0);
+  BOOST_TEST(
+      std::memcmp(
+          serial.depth.data(), tiled.depth.data(),
+          pixels * serial.depth.bytes_per_pixel()) == 0);
+  BOOST_TEST(
+      std::memcmp(
+          serial.samples.depth(0, 0), tiled.samples.depth(0, 0),
+          pixels * swgl::multisample_target::sample_count * sizeof(float)) ==
+      0);
+}
+
+// Compares the serial render against tile sizes that do and don't divide
+// the target, both multiples of the hierarchical depth block.
+template <typename Shader>
+void check_tiled(settings const& s) {
+  swgl::thread_pool pool(4);
+  frame serial;
+  render<Shader>(serial, s, nullptr, 0);
+  for(int tile : {64, 40}) {
+    BOOST_TEST_CONTEXT("tile size " << tile) {
+      frame tiled;
+      render<Shader>(tiled, s, &pool, tile);
+      check_identical(serial, tiled);
+    }
+  }
+}
+
+void check_all_shaders(settings const& s) {
+  check_tiled<swgl::shaders::gouraud>(s);
+  check_tiled<swgl::shaders::phong>(s);
+}
+
+} // namespace
+
+BOOST_AUTO_TEST_CASE(forward) {
+  check_all_shaders(settings());
+}
+
+BOOST_AUTO_TEST_CASE(fixed_point) {
+  settings s;
+  s.raster = swgl::raster_mode::fixed_point;
+  check_all_shaders(s);
+}
+
+BOOST_AUTO_TEST_CASE(hierarchical_depth) {
+  settings s;
+  s.hierarchical_depth = true;
+  check_all_shaders(s);
+}
+
+BOOST_AUTO_TEST_CASE(visibility_buffer) {
+  settings s;
+  s.shading = swgl::shading_mode::visibility_buffer;
+  check_all_shaders(s);
+}
+
+BOOST_AUTO_TEST_CASE(fast_clear) {
+  settings s;
+  s.fast_clear = true;
+  check_all_shaders(s);
+}
+
+BOOST_AUTO_TEST_CASE(multisample) {
+  settings s;
+  s.multisample = true;
+  check_all_shaders(s);
+}
+
+BOOST_AUTO_TEST_CASE(coarse_shading) {
+  settings s;
+  s.rate = swgl::shading_rate::coarse_2x2;
+  check_all_shaders(s);
+  s.rate = swgl::shading_rate::coarse_4x4;
+  check_all_shaders(s);
+}